@@ -0,0 +1,293 @@
+#include <benchmark/benchmark.h>
+#include "YoloV4.hpp"
+#include "YoloVn.hpp"
+#include "YOLOv10.hpp"
+#include "YoloNas.hpp"
+#include "RtDetr.hpp"
+#include "RtDetrUltralytics.hpp"
+#include "StageTimers.hpp"
+#include <random>
+
+namespace
+{
+    constexpr int kNumClasses = 80;
+    constexpr int kBoxesPerObject = 4;
+    const cv::Size kFrameSize(1920, 1080);
+
+    cv::Mat make_frame(int width, int height)
+    {
+        cv::Mat frame(height, width, CV_8UC3);
+        cv::randu(frame, cv::Scalar::all(0), cv::Scalar::all(255));
+        return frame;
+    }
+
+    // Heap allocations per iteration of the timed loop, with -DCOUNT_ALLOCATIONS=ON
+    void count_allocations(benchmark::State& state, const AllocationCounter::Counts& start)
+    {
+        if (AllocationCounter::enabled() && state.iterations() > 0)
+        {
+            const AllocationCounter::Counts end = AllocationCounter::thread_counts();
+            state.counters["allocations"] = static_cast<double>(end.allocations - start.allocations) / state.iterations();
+        }
+    }
+
+    // Owns the buffer behind the views handed to postprocess
+    struct SyntheticTensor
+    {
+        std::vector<int64_t> shape;
+        std::vector<float> data;
+        std::vector<int64_t> labels;    // Int64 tensors (RT-DETR labels)
+
+        TensorView view() const
+        {
+            if (!labels.empty())
+            {
+                return TensorView(TensorType::Int64, shape, labels.data());
+            }
+            return TensorView(TensorType::Float32, shape, data.data());
+        }
+    };
+
+    // Row major head output: cx, cy, w, h (in box_scale units), an optional objectness, then the class
+    // scores. density (per mille) of the rows are confident, clustered a few per object as real heads
+    // output them, the others only carry low background scores.
+    std::vector<float> make_rows(int rows, bool objectness, float box_scale, int density)
+    {
+        const int class_offset = objectness ? 5 : 4;
+        const int stride = class_offset + kNumClasses;
+        std::vector<float> data(static_cast<size_t>(rows) * stride);
+        std::mt19937 rng(42);
+        std::uniform_real_distribution<float> unit(0.f, 1.f);
+        std::uniform_real_distribution<float> background(0.f, 0.05f);
+        std::uniform_real_distribution<float> confident(0.4f, 0.95f);
+        std::normal_distribution<float> jitter(0.f, 0.005f);
+
+        float cx = 0.f, cy = 0.f, w = 0.f, h = 0.f;
+        int label = 0;
+        int in_object = 0;
+        for (int i = 0; i < rows; ++i)
+        {
+            float* row = data.data() + static_cast<size_t>(i) * stride;
+            const bool is_confident = in_object > 0 || static_cast<int>(rng() % 1000) < density;
+            if (is_confident && in_object == 0)
+            {
+                w = 0.02f + unit(rng) * 0.2f;
+                h = 0.02f + unit(rng) * 0.2f;
+                cx = w / 2 + unit(rng) * (1.f - w);
+                cy = h / 2 + unit(rng) * (1.f - h);
+                label = rng() % kNumClasses;
+                in_object = kBoxesPerObject;
+            }
+
+            row[0] = (is_confident ? cx + jitter(rng) : unit(rng)) * box_scale;
+            row[1] = (is_confident ? cy + jitter(rng) : unit(rng)) * box_scale;
+            row[2] = (is_confident ? w + jitter(rng) : unit(rng) * 0.1f) * box_scale;
+            row[3] = (is_confident ? h + jitter(rng) : unit(rng) * 0.1f) * box_scale;
+            if (objectness)
+            {
+                row[4] = is_confident ? confident(rng) + 0.05f : background(rng);
+            }
+            for (int c = 0; c < kNumClasses; ++c)
+            {
+                row[class_offset + c] = background(rng);
+            }
+            if (is_confident)
+            {
+                row[class_offset + label] = confident(rng);
+                --in_object;
+            }
+        }
+        return data;
+    }
+
+    // YOLOv5/6/7: 1 x 25200 x 85, boxes in network pixels
+    std::vector<SyntheticTensor> yolov5_outputs(int density)
+    {
+        return {{{1, 25200, 85}, make_rows(25200, true, 640.f, density)}};
+    }
+
+    // YOLOv8/9: 1 x 84 x 8400, channel major
+    std::vector<SyntheticTensor> yolov8_outputs(int density)
+    {
+        const int anchors = 8400;
+        const int channels = 4 + kNumClasses;
+        const std::vector<float> rows = make_rows(anchors, false, 640.f, density);
+        std::vector<float> data(rows.size());
+        for (int i = 0; i < anchors; ++i)
+        {
+            for (int c = 0; c < channels; ++c)
+            {
+                data[static_cast<size_t>(c) * anchors + i] = rows[static_cast<size_t>(i) * channels + c];
+            }
+        }
+        return {{{1, channels, anchors}, std::move(data)}};
+    }
+
+    // Darknet region layers at 416: three N x 85 outputs, normalized boxes
+    std::vector<SyntheticTensor> yolov4_outputs(int density)
+    {
+        std::vector<SyntheticTensor> outputs;
+        for (const int rows : {507, 2028, 8112})
+        {
+            outputs.push_back({{rows, 85}, make_rows(rows, true, 1.f, density)});
+        }
+        return outputs;
+    }
+
+    // YOLO-NAS: 1 x 8400 x 4 corner boxes and 1 x 8400 x 80 scores
+    std::vector<SyntheticTensor> yolonas_outputs(int density)
+    {
+        const int anchors = 8400;
+        const int stride = 4 + kNumClasses;
+        const std::vector<float> rows = make_rows(anchors, false, 640.f, density);
+        SyntheticTensor boxes{{1, anchors, 4}, std::vector<float>(static_cast<size_t>(anchors) * 4)};
+        SyntheticTensor scores{{1, anchors, kNumClasses}, std::vector<float>(static_cast<size_t>(anchors) * kNumClasses)};
+        for (int i = 0; i < anchors; ++i)
+        {
+            const float* row = rows.data() + static_cast<size_t>(i) * stride;
+            float* box = boxes.data.data() + static_cast<size_t>(i) * 4;
+            box[0] = row[0] - row[2] / 2;
+            box[1] = row[1] - row[3] / 2;
+            box[2] = row[0] + row[2] / 2;
+            box[3] = row[1] + row[3] / 2;
+            std::copy(row + 4, row + stride, scores.data.data() + static_cast<size_t>(i) * kNumClasses);
+        }
+        return {std::move(boxes), std::move(scores)};
+    }
+
+    // RT-DETR (ultralytics export): 1 x 300 x 84, normalized boxes
+    std::vector<SyntheticTensor> rtdetr_ultralytics_outputs(int density)
+    {
+        return {{{1, 300, 84}, make_rows(300, false, 1.f, density)}};
+    }
+
+    // Queries of the end to end models: corner boxes in network pixels, best score and its class
+    void make_queries(int queries, int density, std::vector<float>& boxes, std::vector<float>& scores, std::vector<int64_t>& labels)
+    {
+        const int stride = 4 + kNumClasses;
+        const std::vector<float> rows = make_rows(queries, false, 640.f, density);
+        for (int i = 0; i < queries; ++i)
+        {
+            const float* row = rows.data() + static_cast<size_t>(i) * stride;
+            const float* best = std::max_element(row + 4, row + stride);
+            boxes.insert(boxes.end(), {row[0] - row[2] / 2, row[1] - row[3] / 2, row[0] + row[2] / 2, row[1] + row[3] / 2});
+            scores.push_back(*best);
+            labels.push_back(best - (row + 4));
+        }
+    }
+
+    // YOLOv10: 1 x 300 x 6, x1, y1, x2, y2, score, class
+    std::vector<SyntheticTensor> yolov10_outputs(int density)
+    {
+        std::vector<float> boxes, scores;
+        std::vector<int64_t> labels;
+        make_queries(300, density, boxes, scores, labels);
+        SyntheticTensor output{{1, 300, 6}, {}};
+        for (size_t i = 0; i < scores.size(); ++i)
+        {
+            output.data.insert(output.data.end(), boxes.begin() + i * 4, boxes.begin() + i * 4 + 4);
+            output.data.push_back(scores[i]);
+            output.data.push_back(static_cast<float>(labels[i]));
+        }
+        return {std::move(output)};
+    }
+
+    // RT-DETR: scores 1 x 300, labels 1 x 300, boxes 1 x 300 x 4 (TensorRT output order)
+    std::vector<SyntheticTensor> rtdetr_outputs(int density)
+    {
+        std::vector<float> boxes, scores;
+        std::vector<int64_t> labels;
+        make_queries(300, density, boxes, scores, labels);
+        return {{{1, 300}, std::move(scores)}, {{1, 300}, {}, std::move(labels)}, {{1, 300, 4}, std::move(boxes)}};
+    }
+
+    template <typename DetectorType>
+    void run_postprocess(benchmark::State& state, const std::vector<SyntheticTensor>& tensors)
+    {
+        DetectorType detector;
+        std::vector<TensorView> outputs;
+        for (const SyntheticTensor& tensor : tensors)
+        {
+            outputs.push_back(tensor.view());
+        }
+        std::vector<Detection> detections;
+        const AllocationCounter::Counts start = AllocationCounter::thread_counts();
+        for (auto _ : state)
+        {
+            detector.postprocess(outputs, kFrameSize, detections);
+            benchmark::DoNotOptimize(detections.data());
+        }
+        count_allocations(state, start);
+        state.counters["detections"] = static_cast<double>(detections.size());
+        state.SetItemsProcessed(state.iterations());
+    }
+}
+
+template <typename DetectorType>
+static void BM_Preprocess(benchmark::State& state)
+{
+    const cv::Mat frame = make_frame(state.range(0), state.range(1));
+    DetectorType detector;
+    cv::Mat blob;
+    const AllocationCounter::Counts start = AllocationCounter::thread_counts();
+    for (auto _ : state)
+    {
+        detector.preprocess_image(frame, blob);
+        benchmark::DoNotOptimize(blob.data);
+    }
+    count_allocations(state, start);
+    state.SetItemsProcessed(state.iterations());
+}
+
+static void BM_PostprocessYoloV4(benchmark::State& state)
+{
+    run_postprocess<YoloV4>(state, yolov4_outputs(state.range(0)));
+}
+
+static void BM_PostprocessYoloV5(benchmark::State& state)
+{
+    run_postprocess<YoloVn>(state, yolov5_outputs(state.range(0)));
+}
+
+static void BM_PostprocessYoloV8(benchmark::State& state)
+{
+    run_postprocess<YoloVn>(state, yolov8_outputs(state.range(0)));
+}
+
+static void BM_PostprocessYoloNas(benchmark::State& state)
+{
+    run_postprocess<YoloNas>(state, yolonas_outputs(state.range(0)));
+}
+
+static void BM_PostprocessYOLOv10(benchmark::State& state)
+{
+    run_postprocess<YOLOv10>(state, yolov10_outputs(state.range(0)));
+}
+
+static void BM_PostprocessRtDetr(benchmark::State& state)
+{
+    run_postprocess<RtDetr>(state, rtdetr_outputs(state.range(0)));
+}
+
+static void BM_PostprocessRtDetrUltralytics(benchmark::State& state)
+{
+    run_postprocess<RtDetrUltralytics>(state, rtdetr_ultralytics_outputs(state.range(0)));
+}
+
+#define FRAME_SIZES Args({640, 480})->Args({1280, 720})->Args({1920, 1080})->Args({3840, 2160})->Unit(benchmark::kMicrosecond)
+BENCHMARK_TEMPLATE(BM_Preprocess, YoloV4)->FRAME_SIZES;
+BENCHMARK_TEMPLATE(BM_Preprocess, YoloVn)->FRAME_SIZES;
+BENCHMARK_TEMPLATE(BM_Preprocess, YoloNas)->FRAME_SIZES;
+BENCHMARK_TEMPLATE(BM_Preprocess, YOLOv10)->FRAME_SIZES;
+BENCHMARK_TEMPLATE(BM_Preprocess, RtDetr)->FRAME_SIZES;
+BENCHMARK_TEMPLATE(BM_Preprocess, RtDetrUltralytics)->FRAME_SIZES;
+
+// Per mille of the anchors or queries above the confidence threshold
+#define CANDIDATE_DENSITIES Arg(1)->Arg(10)->Arg(50)->Unit(benchmark::kMicrosecond)
+BENCHMARK(BM_PostprocessYoloV4)->CANDIDATE_DENSITIES;
+BENCHMARK(BM_PostprocessYoloV5)->CANDIDATE_DENSITIES;
+BENCHMARK(BM_PostprocessYoloV8)->CANDIDATE_DENSITIES;
+BENCHMARK(BM_PostprocessYoloNas)->CANDIDATE_DENSITIES;
+BENCHMARK(BM_PostprocessYOLOv10)->CANDIDATE_DENSITIES;
+BENCHMARK(BM_PostprocessRtDetr)->CANDIDATE_DENSITIES;
+BENCHMARK(BM_PostprocessRtDetrUltralytics)->CANDIDATE_DENSITIES;
@@ -0,0 +1,75 @@
+#include <benchmark/benchmark.h>
+#include "InferenceInterface.hpp"
+
+namespace
+{
+    const std::vector<int> kBlobShape = {1, 3, 640, 640};
+
+    // Does everything a backend does before running the model: stages (or packs) the input into the arena
+    class StagingEngine : public InferenceInterface
+    {
+    public:
+        StagingEngine() : InferenceInterface("", "", false)
+        {
+        }
+
+        std::vector<TensorView> get_infer_results(const cv::Mat& input_blob) override
+        {
+            benchmark::DoNotOptimize(stage_input(input_blob));
+            return {};
+        }
+
+        size_t max_batch_size() const override
+        {
+            return 8;
+        }
+    };
+
+    cv::Mat make_blob()
+    {
+        cv::Mat blob(kBlobShape, CV_32F);
+        cv::randu(blob, cv::Scalar::all(0), cv::Scalar::all(1));
+        return blob;
+    }
+}
+
+// A blob preprocessed into its own buffer is copied into the arena
+static void BM_StageInputCopy(benchmark::State& state)
+{
+    StagingEngine engine;
+    const cv::Mat blob = make_blob();
+    for (auto _ : state)
+    {
+        engine.get_infer_results(blob);
+    }
+    state.SetBytesProcessed(state.iterations() * blob.total() * blob.elemSize());
+}
+
+// A blob preprocessed straight into the arena is only checked
+static void BM_StageInputInPlace(benchmark::State& state)
+{
+    StagingEngine engine;
+    cv::Mat& arena = engine.get_input_blob();
+    make_blob().copyTo(arena);
+    for (auto _ : state)
+    {
+        engine.get_infer_results(arena);
+    }
+    state.SetItemsProcessed(state.iterations());
+}
+
+// Packing separate blobs into the N x C x H x W arena and slicing the outputs back
+static void BM_PackBatch(benchmark::State& state)
+{
+    StagingEngine engine;
+    const std::vector<cv::Mat> blobs(state.range(0), make_blob());
+    for (auto _ : state)
+    {
+        benchmark::DoNotOptimize(engine.get_infer_results_batch(blobs).data());
+    }
+    state.SetItemsProcessed(state.iterations() * state.range(0));
+}
+
+BENCHMARK(BM_StageInputCopy)->Unit(benchmark::kMicrosecond);
+BENCHMARK(BM_StageInputInPlace)->Unit(benchmark::kMicrosecond);
+BENCHMARK(BM_PackBatch)->Arg(1)->Arg(4)->Arg(8)->Unit(benchmark::kMicrosecond);
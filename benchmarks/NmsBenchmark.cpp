@@ -0,0 +1,124 @@
+#include <benchmark/benchmark.h>
+#include "NonMaxSuppression.hpp"
+#include <map>
+#include <random>
+
+namespace
+{
+    constexpr float kIouThreshold = 0.4f;
+    constexpr int kNumClasses = 80;
+
+    // Clustered candidates as a detector head outputs them: a few anchors around every object
+    void make_candidates(int count, std::vector<cv::Rect>& rects, std::vector<float>& scores, std::vector<int>& class_ids, BoxCandidates& candidates)
+    {
+        std::mt19937 rng(42);
+        std::uniform_real_distribution<float> position(0.f, 1.f);
+        std::uniform_real_distribution<float> size(16.f, 160.f);
+        std::normal_distribution<float> jitter(0.f, 4.f);
+        std::uniform_real_distribution<float> score(0.25f, 1.f);
+
+        const int per_object = 4;
+        for (int i = 0; i < count; i += per_object)
+        {
+            const float w = size(rng);
+            const float h = size(rng);
+            const float x = position(rng) * (1920.f - w);
+            const float y = position(rng) * (1080.f - h);
+            const int label = rng() % kNumClasses;
+            for (int k = 0; k < per_object && i + k < count; ++k)
+            {
+                const cv::Rect rect(cvRound(x + jitter(rng)), cvRound(y + jitter(rng)), cvRound(w + jitter(rng)), cvRound(h + jitter(rng)));
+                const float s = score(rng);
+                rects.push_back(rect);
+                scores.push_back(s);
+                class_ids.push_back(label);
+                candidates.add(rect, s, label);
+            }
+        }
+    }
+}
+
+static void BM_OpenCVNMSBoxes(benchmark::State& state)
+{
+    std::vector<cv::Rect> rects;
+    std::vector<float> scores;
+    std::vector<int> class_ids;
+    BoxCandidates candidates;
+    make_candidates(state.range(0), rects, scores, class_ids, candidates);
+    std::vector<int> indices;
+    for (auto _ : state)
+    {
+        cv::dnn::NMSBoxes(rects, scores, 0.f, kIouThreshold, indices);
+        benchmark::DoNotOptimize(indices.data());
+    }
+    state.SetItemsProcessed(state.iterations() * state.range(0));
+}
+
+// Per class NMSBoxes calls, as YoloV4 used to do
+static void BM_OpenCVNMSBoxesPerClass(benchmark::State& state)
+{
+    std::vector<cv::Rect> rects;
+    std::vector<float> scores;
+    std::vector<int> class_ids;
+    BoxCandidates candidates;
+    make_candidates(state.range(0), rects, scores, class_ids, candidates);
+    std::vector<int> indices;
+    for (auto _ : state)
+    {
+        std::map<int, std::vector<size_t>> class2indices;
+        for (size_t i = 0; i < class_ids.size(); ++i)
+        {
+            class2indices[class_ids[i]].push_back(i);
+        }
+        for (const auto& [label, members] : class2indices)
+        {
+            std::vector<cv::Rect> local_rects;
+            std::vector<float> local_scores;
+            for (const size_t i : members)
+            {
+                local_rects.push_back(rects[i]);
+                local_scores.push_back(scores[i]);
+            }
+            cv::dnn::NMSBoxes(local_rects, local_scores, 0.f, kIouThreshold, indices);
+            benchmark::DoNotOptimize(indices.data());
+        }
+    }
+    state.SetItemsProcessed(state.iterations() * state.range(0));
+}
+
+static void BM_NonMaxSuppression(benchmark::State& state)
+{
+    std::vector<cv::Rect> rects;
+    std::vector<float> scores;
+    std::vector<int> class_ids;
+    BoxCandidates candidates;
+    make_candidates(state.range(0), rects, scores, class_ids, candidates);
+    // No top_k, every candidate goes through the suppression like with NMSBoxes
+    NonMaxSuppression nms(0);
+    for (auto _ : state)
+    {
+        benchmark::DoNotOptimize(nms.run(candidates, kIouThreshold, false).data());
+    }
+    state.SetItemsProcessed(state.iterations() * state.range(0));
+}
+
+static void BM_NonMaxSuppressionClassAware(benchmark::State& state)
+{
+    std::vector<cv::Rect> rects;
+    std::vector<float> scores;
+    std::vector<int> class_ids;
+    BoxCandidates candidates;
+    make_candidates(state.range(0), rects, scores, class_ids, candidates);
+    NonMaxSuppression nms(0);
+    for (auto _ : state)
+    {
+        benchmark::DoNotOptimize(nms.run(candidates, kIouThreshold, true).data());
+    }
+    state.SetItemsProcessed(state.iterations() * state.range(0));
+}
+
+#define CANDIDATE_COUNTS Arg(100)->Arg(1000)->Arg(10000)->Unit(benchmark::kMicrosecond)
+BENCHMARK(BM_OpenCVNMSBoxes)->CANDIDATE_COUNTS;
+BENCHMARK(BM_OpenCVNMSBoxesPerClass)->CANDIDATE_COUNTS;
+BENCHMARK(BM_NonMaxSuppression)->CANDIDATE_COUNTS;
+BENCHMARK(BM_NonMaxSuppressionClassAware)->CANDIDATE_COUNTS;
@@ -0,0 +1,95 @@
+#include <benchmark/benchmark.h>
+#include "FusedPreprocessor.hpp"
+
+namespace
+{
+    constexpr int kNetworkSize = 640;
+
+    cv::Mat make_frame(int width, int height)
+    {
+        cv::Mat frame(height, width, CV_8UC3);
+        cv::randu(frame, cv::Scalar::all(0), cv::Scalar::all(255));
+        return frame;
+    }
+
+    // OpenCV chain YoloVn::preprocess_image used before the fused kernel
+    void opencv_letterbox(const cv::Mat& img, cv::Mat& blob, int network_width, int network_height)
+    {
+        int w, h, x, y;
+        float r_w = network_width / (img.cols*1.0);
+        float r_h = network_height / (img.rows*1.0);
+        if (r_h > r_w) {
+            w = network_width;
+            h = r_w * img.rows;
+            x = 0;
+            y = (network_height - h) / 2;
+        } else {
+            w = r_h * img.cols;
+            h = network_height;
+            x = (network_width - w) / 2;
+            y = 0;
+        }
+        cv::Mat re(h, w, CV_8UC3);
+        cv::resize(img, re, re.size(), 0, 0, cv::INTER_LINEAR);
+        cv::Mat out(network_height, network_width, CV_8UC3, cv::Scalar(128, 128, 128));
+        re.copyTo(out(cv::Rect(x, y, re.cols, re.rows)));
+        cv::dnn::blobFromImage(out, blob, 1 / 255.F, cv::Size(), cv::Scalar(), true, false);
+    }
+}
+
+static void BM_OpenCVLetterbox(benchmark::State& state)
+{
+    const cv::Mat frame = make_frame(state.range(0), state.range(1));
+    cv::Mat blob;
+    for (auto _ : state)
+    {
+        opencv_letterbox(frame, blob, kNetworkSize, kNetworkSize);
+        benchmark::DoNotOptimize(blob.data);
+    }
+    state.SetItemsProcessed(state.iterations());
+}
+
+static void BM_FusedLetterbox(benchmark::State& state)
+{
+    const cv::Mat frame = make_frame(state.range(0), state.range(1));
+    FusedPreprocessor preprocessor{kNetworkSize, kNetworkSize, true, true};
+    cv::Mat blob;
+    for (auto _ : state)
+    {
+        preprocessor.run(frame, blob);
+        benchmark::DoNotOptimize(blob.data);
+    }
+    state.SetItemsProcessed(state.iterations());
+}
+
+// Plain resize path of blobFromImage, used by YoloV4, RT-DETR and YOLOv10
+static void BM_OpenCVBlobFromImage(benchmark::State& state)
+{
+    const cv::Mat frame = make_frame(state.range(0), state.range(1));
+    cv::Mat blob;
+    for (auto _ : state)
+    {
+        cv::dnn::blobFromImage(frame, blob, 1.f / 255.f, cv::Size(kNetworkSize, kNetworkSize), cv::Scalar(), true, false);
+        benchmark::DoNotOptimize(blob.data);
+    }
+    state.SetItemsProcessed(state.iterations());
+}
+
+static void BM_FusedResize(benchmark::State& state)
+{
+    const cv::Mat frame = make_frame(state.range(0), state.range(1));
+    FusedPreprocessor preprocessor{kNetworkSize, kNetworkSize, false, true};
+    cv::Mat blob;
+    for (auto _ : state)
+    {
+        preprocessor.run(frame, blob);
+        benchmark::DoNotOptimize(blob.data);
+    }
+    state.SetItemsProcessed(state.iterations());
+}
+
+#define FRAME_SIZES Args({640, 480})->Args({1280, 720})->Args({1920, 1080})->Args({3840, 2160})->Unit(benchmark::kMicrosecond)
+BENCHMARK(BM_OpenCVLetterbox)->FRAME_SIZES;
+BENCHMARK(BM_FusedLetterbox)->FRAME_SIZES;
+BENCHMARK(BM_OpenCVBlobFromImage)->FRAME_SIZES;
+BENCHMARK(BM_FusedResize)->FRAME_SIZES;
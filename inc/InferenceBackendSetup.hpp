@@ -1,6 +1,7 @@
 #pragma once
 #include "common.hpp"
 #include "InferenceInterface.hpp"
+#include "EnginePool.hpp"
 #ifdef USE_ONNX_RUNTIME
 #include "ORTInfer.hpp"
 #elif USE_LIBTORCH 
@@ -15,10 +16,50 @@
 #include "OVInfer.hpp"
 #endif
 
-std::unique_ptr<InferenceInterface> setup_inference_engine(const std::string& weights, const std::string& modelConfiguration )
+// Backend selected at build time (DEFAULT_BACKEND)
+inline const char* inference_backend_name()
 {
     #ifdef USE_ONNX_RUNTIME
-    return std::make_unique<ORTInfer>(weights, false); 
+    return "ONNX_RUNTIME";
+    #elif USE_LIBTORCH 
+    return "LIBTORCH";
+    #elif USE_LIBTENSORFLOW 
+    return "LIBTENSORFLOW";
+    #elif USE_OPENCV_DNN 
+    return "OPENCV_DNN";
+    #elif USE_TENSORRT
+    return "TENSORRT";
+    #elif USE_OPENVINO
+    return "OPENVINO";
+    #endif
+    return "";
+}
+
+// throughput and num_streams tune the OpenVINO compilation, num_threads the OpenVINO and ONNX Runtime thread budget
+// (per replica), io_binding enables the ONNX Runtime IoBinding path, other backends ignore them.
+// replicas > 1 returns an EnginePool of that many engines.
+inline std::unique_ptr<InferenceInterface> setup_inference_engine(const std::string& weights, const std::string& modelConfiguration,
+    bool throughput = false, int num_streams = 0, int num_threads = 0, int replicas = 1, bool io_binding = false)
+{
+    if (replicas > 1)
+    {
+        std::vector<std::unique_ptr<InferenceInterface>> engines;
+        for (int i = 0; i < replicas; ++i)
+        {
+            std::unique_ptr<InferenceInterface> engine = setup_inference_engine(weights, modelConfiguration, throughput, num_streams, num_threads, 1, io_binding);
+            if (!engine)
+            {
+                return nullptr;
+            }
+            engines.push_back(std::move(engine));
+        }
+        return std::make_unique<EnginePool>(std::move(engines));
+    }
+
+    #ifdef USE_ONNX_RUNTIME
+    // Replicas of the same model share their prepacked weights, the container outlives every session
+    static Ort::PrepackedWeightsContainer prepacked_weights;
+    return std::make_unique<ORTInfer>(weights, false, io_binding, num_threads, &prepacked_weights); 
     #elif USE_LIBTORCH 
     return std::make_unique<LibtorchInfer>(weights, false); 
     #elif USE_LIBTENSORFLOW 
@@ -28,7 +69,7 @@ std::unique_ptr<InferenceInterface> setup_inference_engine(const std::string& we
     #elif USE_TENSORRT
     return std::make_unique<TRTInfer>(weights); 
     #elif USE_OPENVINO
-    return std::make_unique<OVInfer>("", modelConfiguration, false); 
+    return std::make_unique<OVInfer>("", modelConfiguration, false, throughput, num_streams, num_threads); 
     #endif
     return nullptr;
 
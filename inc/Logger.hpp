@@ -3,10 +3,14 @@
 // Define a global logger variable
 std::shared_ptr<spdlog::logger> logger;
 
-void initializeLogger() {
+// console_to_stderr keeps stdout for the program's own output (--output stdout)
+void initializeLogger(bool console_to_stderr = false) {
 
     std::vector<spdlog::sink_ptr> sinks;
-    sinks.push_back(std::make_shared<spdlog::sinks::stdout_color_sink_mt>());
+    if (console_to_stderr)
+        sinks.push_back(std::make_shared<spdlog::sinks::stderr_color_sink_mt>());
+    else
+        sinks.push_back(std::make_shared<spdlog::sinks::stdout_color_sink_mt>());
     sinks.push_back( std::make_shared<spdlog::sinks::rotating_file_sink_mt>("logs/output.log", 1024*1024*10, 3, true));
     logger = std::make_shared<spdlog::logger>("logger", begin(sinks), end(sinks));
 
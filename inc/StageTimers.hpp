@@ -0,0 +1,296 @@
+#pragma once
+#include "common.hpp"
+#include "Trace.hpp"
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+
+// Log-linear latency histogram (HDR style) over nanoseconds: exact below 32 ns, then 32 linear
+// sub-buckets per power of two, so reported percentiles are within ~3% of the recorded values.
+// record() is a handful of relaxed atomic operations, any number of threads may record and report.
+class LatencyHistogram
+{
+public:
+    void record(uint64_t ns)
+    {
+        counts_[bucket_index(ns)].fetch_add(1, std::memory_order_relaxed);
+        count_.fetch_add(1, std::memory_order_relaxed);
+        sum_.fetch_add(ns, std::memory_order_relaxed);
+        uint64_t max = max_.load(std::memory_order_relaxed);
+        while (ns > max && !max_.compare_exchange_weak(max, ns, std::memory_order_relaxed))
+        {
+        }
+    }
+
+    uint64_t count() const { return count_.load(std::memory_order_relaxed); }
+    uint64_t max() const { return max_.load(std::memory_order_relaxed); }
+
+    double mean() const
+    {
+        const uint64_t n = count();
+        return n > 0 ? static_cast<double>(sum_.load(std::memory_order_relaxed)) / n : 0.0;
+    }
+
+    // Upper bound of the bucket holding the p-th percentile (0 to 100), capped at the max
+    uint64_t percentile(double p) const
+    {
+        const uint64_t n = count();
+        if (n == 0)
+        {
+            return 0;
+        }
+        const uint64_t rank = std::max<uint64_t>(static_cast<uint64_t>(p / 100.0 * n + 0.5), 1);
+        uint64_t seen = 0;
+        for (size_t i = 0; i < buckets; ++i)
+        {
+            seen += counts_[i].load(std::memory_order_relaxed);
+            if (seen >= rank)
+            {
+                return std::min(bucket_upper(i), max());
+            }
+        }
+        return max();
+    }
+
+private:
+    static constexpr int sub_bucket_bits = 5;
+    static constexpr uint64_t sub_buckets = uint64_t{1} << sub_bucket_bits;
+    static constexpr size_t buckets = (64 - sub_bucket_bits + 1) * sub_buckets;
+
+    static size_t bucket_index(uint64_t ns)
+    {
+        if (ns < sub_buckets)
+        {
+            return static_cast<size_t>(ns);
+        }
+        const int shift = 63 - __builtin_clzll(ns) - sub_bucket_bits;
+        return static_cast<size_t>((shift + 1) * sub_buckets + (ns >> shift) - sub_buckets);
+    }
+
+    static uint64_t bucket_upper(size_t index)
+    {
+        if (index < sub_buckets)
+        {
+            return index;
+        }
+        const int shift = static_cast<int>(index / sub_buckets) - 1;
+        const uint64_t top = sub_buckets + index % sub_buckets;
+        return ((top + 1) << shift) - 1;
+    }
+
+    std::array<std::atomic<uint64_t>, buckets> counts_{};
+    std::atomic<uint64_t> count_{0};
+    std::atomic<uint64_t> sum_{0};
+    std::atomic<uint64_t> max_{0};
+};
+
+enum class Stage
+{
+    Capture,    // Frame read, image decode in batch image mode
+    Preprocess,
+    Inference,  // Per inference call, a batch counts once
+    Postprocess,
+    Nms,        // Part of postprocess
+    Render,
+    Count
+};
+
+struct AllocationCounts
+{
+    uint64_t allocations{0};
+    uint64_t bytes{0};
+};
+
+// Heap allocations per stage. The counts come from the global operator new and cv::Mat allocator
+// replacements of src/AllocationHook.cpp, built with -DCOUNT_ALLOCATIONS=ON, and stay zero otherwise.
+// AllocationScope attributes the allocations of its thread to a stage.
+class AllocationCounter
+{
+public:
+    using Counts = AllocationCounts;
+
+    static constexpr bool enabled()
+    {
+#ifdef COUNT_ALLOCATIONS
+        return true;
+#else
+        return false;
+#endif
+    }
+
+    // Called by the hooks for every allocation, must not allocate
+    static void on_allocation(size_t bytes)
+    {
+        ++thread_counts_.allocations;
+        thread_counts_.bytes += bytes;
+        if (checked_stage_ && checking_.load(std::memory_order_relaxed))
+        {
+            fail(bytes);
+        }
+    }
+
+    // Bytes of an allocation already counted, cv::Mat data behind its header
+    static void on_bytes(size_t bytes)
+    {
+        thread_counts_.bytes += bytes;
+    }
+
+    static Counts thread_counts()
+    {
+        return thread_counts_;
+    }
+
+    static Counts stage_counts(Stage stage)
+    {
+        const size_t i = static_cast<size_t>(stage);
+        return {allocations_[i].load(std::memory_order_relaxed), bytes_[i].load(std::memory_order_relaxed)};
+    }
+
+    // Steady state check: from now on an allocation inside a preprocess or postprocess (NMS included)
+    // scope aborts the process from the allocating call, so a debugger or core dump shows the culprit.
+    // Inference, capture and render are not checked, backends and OpenCV I/O allocate internally.
+    static void start_checking()
+    {
+        checking_.store(true, std::memory_order_relaxed);
+    }
+
+    static bool checked(Stage stage)
+    {
+        return stage == Stage::Preprocess || stage == Stage::Postprocess || stage == Stage::Nms;
+    }
+
+private:
+    friend class AllocationScope;
+
+    static const char* enter(Stage stage, const char* name)
+    {
+        const char* outer = checked_stage_;
+        if (checked(stage))
+        {
+            checked_stage_ = name;
+        }
+        return outer;
+    }
+
+    static void leave(Stage stage, const Counts& start, const char* outer)
+    {
+        const size_t i = static_cast<size_t>(stage);
+        allocations_[i].fetch_add(thread_counts_.allocations - start.allocations, std::memory_order_relaxed);
+        bytes_[i].fetch_add(thread_counts_.bytes - start.bytes, std::memory_order_relaxed);
+        checked_stage_ = outer;
+    }
+
+    [[noreturn]] static void fail(size_t bytes)
+    {
+        checking_.store(false, std::memory_order_relaxed);
+        std::fprintf(stderr, "Allocation of %zu bytes in the %s stage after warmup\n", bytes, checked_stage_);
+        std::abort();
+    }
+
+    inline static std::array<std::atomic<uint64_t>, static_cast<size_t>(Stage::Count)> allocations_{};
+    inline static std::array<std::atomic<uint64_t>, static_cast<size_t>(Stage::Count)> bytes_{};
+    inline static std::atomic<bool> checking_{false};
+    inline static thread_local Counts thread_counts_;
+    inline static thread_local const char* checked_stage_{nullptr};
+};
+
+// Process wide per stage latency histograms, fed by ScopedStageTimer or record() from any thread.
+// Every recorded interval is also a trace event when tracing is enabled.
+class StageTimers
+{
+public:
+    using Clock = std::chrono::steady_clock;
+
+    static void record(Stage stage, Clock::time_point start, Clock::time_point end)
+    {
+        histograms_[static_cast<size_t>(stage)].record(static_cast<uint64_t>(std::chrono::duration_cast<std::chrono::nanoseconds>(end - start).count()));
+        Trace::record(name(stage), start, end);
+    }
+
+    static const LatencyHistogram& histogram(Stage stage)
+    {
+        return histograms_[static_cast<size_t>(stage)];
+    }
+
+    static const char* name(Stage stage)
+    {
+        static const char* const names[] = {"capture", "preprocess", "inference", "postprocess", "nms", "render"};
+        return names[static_cast<size_t>(stage)];
+    }
+
+    // One line per stage that recorded anything, latencies in ms
+    static void log(spdlog::logger& logger)
+    {
+        for (size_t i = 0; i < static_cast<size_t>(Stage::Count); ++i)
+        {
+            const LatencyHistogram& h = histograms_[i];
+            if (h.count() == 0)
+            {
+                continue;
+            }
+            logger.info("{:<11} n {:>8}  mean {:8.3f}  p50 {:8.3f}  p90 {:8.3f}  p99 {:8.3f}  max {:8.3f} ms", name(static_cast<Stage>(i)), h.count(),
+                h.mean() / 1e6, h.percentile(50) / 1e6, h.percentile(90) / 1e6, h.percentile(99) / 1e6, h.max() / 1e6);
+            if (AllocationCounter::enabled())
+            {
+                const AllocationCounter::Counts counts = AllocationCounter::stage_counts(static_cast<Stage>(i));
+                logger.info("{:<11} {:.2f} allocations, {:.0f} bytes per call", "", static_cast<double>(counts.allocations) / h.count(),
+                    static_cast<double>(counts.bytes) / h.count());
+            }
+        }
+    }
+
+private:
+    inline static std::array<LatencyHistogram, static_cast<size_t>(Stage::Count)> histograms_;
+};
+
+// Counts the allocations of the calling thread during the scope towards the stage
+class AllocationScope
+{
+public:
+    explicit AllocationScope(Stage stage) :
+        stage_{stage},
+        start_{AllocationCounter::thread_counts()},
+        outer_{AllocationCounter::enter(stage, StageTimers::name(stage))}
+    {
+    }
+
+    ~AllocationScope()
+    {
+        AllocationCounter::leave(stage_, start_, outer_);
+    }
+
+    AllocationScope(const AllocationScope&) = delete;
+    AllocationScope& operator=(const AllocationScope&) = delete;
+
+private:
+    Stage stage_;
+    AllocationCounter::Counts start_;
+    const char* outer_;
+};
+
+// Records the lifetime of the scope into the stage histogram, and its allocations
+class ScopedStageTimer
+{
+public:
+    explicit ScopedStageTimer(Stage stage) :
+        stage_{stage},
+        allocations_{stage},
+        start_{StageTimers::Clock::now()}
+    {
+    }
+
+    ~ScopedStageTimer()
+    {
+        StageTimers::record(stage_, start_, StageTimers::Clock::now());
+    }
+
+    ScopedStageTimer(const ScopedStageTimer&) = delete;
+    ScopedStageTimer& operator=(const ScopedStageTimer&) = delete;
+
+private:
+    Stage stage_;
+    AllocationScope allocations_;
+    StageTimers::Clock::time_point start_;
+};
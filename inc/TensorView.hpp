@@ -0,0 +1,153 @@
+#pragma once
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+// Element types an inference backend can hand back to a detector
+enum class TensorType
+{
+    Float32,
+    Int32,
+    Int64
+};
+
+template <typename T> struct TensorTypeOf;
+template <> struct TensorTypeOf<float>   { static constexpr TensorType value = TensorType::Float32; };
+template <> struct TensorTypeOf<int32_t> { static constexpr TensorType value = TensorType::Int32; };
+template <> struct TensorTypeOf<int64_t> { static constexpr TensorType value = TensorType::Int64; };
+
+// Typed, strided, non-owning view over an output buffer owned by the backend.
+// The owner handle keeps the backing storage alive as long as the view exists,
+// but backends that reuse their output buffers (OpenVINO, TensorRT, ONNX Runtime
+// with IoBinding) overwrite the content on the next get_infer_results call on the
+// same engine, see InferenceInterface::output_buffers_reused.
+class TensorView
+{
+public:
+    TensorView() = default;
+
+    TensorView(TensorType type, std::vector<int64_t> shape, const void* data,
+        std::shared_ptr<const void> owner = nullptr, std::vector<int64_t> strides = {}) :
+        type_{type},
+        shape_{std::move(shape)},
+        strides_{std::move(strides)},
+        data_{data},
+        owner_{std::move(owner)}
+    {
+        if (strides_.empty())
+        {
+            strides_.resize(shape_.size());
+            int64_t stride = 1;
+            for (size_t i = shape_.size(); i-- > 0;)
+            {
+                strides_[i] = stride;
+                stride *= shape_[i];
+            }
+        }
+    }
+
+    TensorType type() const { return type_; }
+    const std::vector<int64_t>& shape() const { return shape_; }
+    const std::vector<int64_t>& strides() const { return strides_; }   // in elements
+    int64_t dim(size_t i) const { return shape_[i]; }
+    size_t rank() const { return shape_.size(); }
+    const void* raw_data() const { return data_; }
+    const std::shared_ptr<const void>& owner() const { return owner_; }
+
+    size_t element_size() const { return element_size(type_); }
+
+    size_t numel() const
+    {
+        size_t n = 1;
+        for (const auto d : shape_)
+            n *= static_cast<size_t>(d);
+        return n;
+    }
+
+    bool is_contiguous() const
+    {
+        int64_t stride = 1;
+        for (size_t i = shape_.size(); i-- > 0;)
+        {
+            if (shape_[i] != 1 && strides_[i] != stride)
+                return false;
+            stride *= shape_[i];
+        }
+        return true;
+    }
+
+    // Rows [first, first + count) of the outermost dimension, sharing the buffer and its owner.
+    // Used to hand every image of a batched output its own view.
+    TensorView slice(int64_t first, int64_t count) const
+    {
+        std::vector<int64_t> shape = shape_;
+        shape[0] = count;
+        const auto* data = static_cast<const uint8_t*>(data_) + first * strides_[0] * static_cast<int64_t>(element_size());
+        return TensorView(type_, std::move(shape), data, owner_, strides_);
+    }
+
+    // Contiguous copy owning its buffer, for outputs that must outlive the next call on an engine reusing them
+    TensorView clone() const
+    {
+        if (!is_contiguous())
+            throw std::runtime_error("TensorView: can't clone a non contiguous tensor");
+        const auto* begin = static_cast<const uint8_t*>(data_);
+        auto buffer = std::make_shared<std::vector<uint8_t>>(begin, begin + numel() * element_size());
+        return TensorView(type_, shape_, buffer->data(), buffer);
+    }
+
+    // Typed access to the underlying buffer, the requested type must match the tensor type
+    template <typename T>
+    const T* data() const
+    {
+        if (TensorTypeOf<T>::value != type_)
+            throw std::runtime_error("TensorView: requested type doesn't match tensor type " + type_name(type_));
+        return static_cast<const T*>(data_);
+    }
+
+    // Converting read of the i-th element in memory order, meant for small outputs (labels, counts)
+    // whose integer width changes between backends
+    template <typename T>
+    T value(size_t i) const
+    {
+        switch (type_)
+        {
+            case TensorType::Float32: return static_cast<T>(static_cast<const float*>(data_)[i]);
+            case TensorType::Int32:   return static_cast<T>(static_cast<const int32_t*>(data_)[i]);
+            case TensorType::Int64:   return static_cast<T>(static_cast<const int64_t*>(data_)[i]);
+        }
+        return T{};
+    }
+
+    static size_t element_size(TensorType type)
+    {
+        switch (type)
+        {
+            case TensorType::Float32: return sizeof(float);
+            case TensorType::Int32:   return sizeof(int32_t);
+            case TensorType::Int64:   return sizeof(int64_t);
+        }
+        return 0;
+    }
+
+    static std::string type_name(TensorType type)
+    {
+        switch (type)
+        {
+            case TensorType::Float32: return "Float32";
+            case TensorType::Int32:   return "Int32";
+            case TensorType::Int64:   return "Int64";
+        }
+        return "Unknown";
+    }
+
+private:
+    TensorType type_{TensorType::Float32};
+    std::vector<int64_t> shape_;
+    std::vector<int64_t> strides_;
+    const void* data_{nullptr};
+    std::shared_ptr<const void> owner_;
+};
@@ -0,0 +1,205 @@
+#pragma once
+#include "common.hpp"
+#include <atomic>
+#include <chrono>
+#include <memory>
+#include <mutex>
+
+// Timeline of scoped events in Chrome trace-event format (chrome://tracing, ui.perfetto.dev).
+// Every thread records into its own fixed size ring buffer, keeping the latest events, with relaxed
+// atomic stores only: no lock and no allocation once the thread is registered, by set_thread_name
+// while enabled or else by its first event. While disabled, a trace point costs one relaxed load,
+// so they stay compiled in.
+class Trace
+{
+public:
+    using Clock = std::chrono::steady_clock;
+
+    static bool enabled()
+    {
+        return enabled_.load(std::memory_order_relaxed);
+    }
+
+    // events_per_thread is fixed for buffers created from then on
+    static void enable(size_t events_per_thread = 1 << 16)
+    {
+        events_per_thread_ = std::max<size_t>(events_per_thread, 1);
+        enabled_.store(true, std::memory_order_relaxed);
+    }
+
+    static void disable()
+    {
+        enabled_.store(false, std::memory_order_relaxed);
+    }
+
+    // Thread name shown in the timeline, for threads that record events. While enabled it also creates
+    // the thread's buffer, so the first event doesn't allocate (inside an allocation checked scope);
+    // the name of a registered thread doesn't change anymore.
+    static void set_thread_name(const std::string& name)
+    {
+        if (local_buffer_)
+        {
+            return;
+        }
+        thread_name_ = name;
+        if (enabled())
+        {
+            local_buffer_ = register_thread();
+        }
+    }
+
+    // name must be a string literal (or outlive the dump)
+    static void record(const char* name, Clock::time_point start, Clock::time_point end)
+    {
+        if (!enabled())
+        {
+            return;
+        }
+        if (!local_buffer_)
+        {
+            local_buffer_ = register_thread();
+        }
+        local_buffer_->push(name, start, end);
+    }
+
+    // Async signal safe, the dump itself happens on the next dump_if_requested
+    static void request_dump()
+    {
+        dump_requested_.store(true, std::memory_order_relaxed);
+    }
+
+    static bool dump_if_requested(const std::string& path)
+    {
+        return dump_requested_.exchange(false, std::memory_order_relaxed) && dump(path);
+    }
+
+    // Writes the events still held by every buffer, safe while other threads keep recording
+    static bool dump(const std::string& path)
+    {
+        std::FILE* file = std::fopen(path.c_str(), "w");
+        if (!file)
+        {
+            return false;
+        }
+        std::fputs("{\"displayTimeUnit\":\"ms\",\"traceEvents\":[\n", file);
+        bool first = true;
+        std::lock_guard<std::mutex> lock(registry_mutex_);
+        for (const auto& buffer : buffers_)
+        {
+            std::fprintf(file, "%s{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":1,\"tid\":%u,\"args\":{\"name\":\"%s\"}}",
+                first ? "" : ",\n", buffer->tid, buffer->name.c_str());
+            first = false;
+            buffer->write_events(file);
+        }
+        std::fputs("\n]}\n", file);
+        return std::fclose(file) == 0;
+    }
+
+private:
+    struct Event
+    {
+        std::atomic<const char*> name{nullptr};
+        std::atomic<int64_t> start_ns{0};
+        std::atomic<int64_t> duration_ns{0};
+    };
+
+    // Single writer ring, readers validate the slots they copied against the head afterwards
+    struct Buffer
+    {
+        Buffer(uint32_t tid, std::string name, size_t capacity) :
+            tid{tid},
+            name{std::move(name)},
+            events(capacity)
+        {
+        }
+
+        void push(const char* event_name, Clock::time_point start, Clock::time_point end)
+        {
+            const uint64_t h = head.load(std::memory_order_relaxed);
+            // A reader seeing any of the stores below also sees the head of the previous push
+            std::atomic_thread_fence(std::memory_order_release);
+            Event& event = events[h % events.size()];
+            event.name.store(event_name, std::memory_order_relaxed);
+            event.start_ns.store(std::chrono::duration_cast<std::chrono::nanoseconds>(start - epoch_).count(), std::memory_order_relaxed);
+            event.duration_ns.store(std::chrono::duration_cast<std::chrono::nanoseconds>(end - start).count(), std::memory_order_relaxed);
+            head.store(h + 1, std::memory_order_release);
+        }
+
+        void write_events(std::FILE* file) const
+        {
+            const uint64_t end = head.load(std::memory_order_acquire);
+            const uint64_t begin = end > events.size() ? end - events.size() : 0;
+            struct Copy { const char* name; int64_t start_ns; int64_t duration_ns; };
+            std::vector<Copy> copies;
+            copies.reserve(end - begin);
+            for (uint64_t i = begin; i < end; ++i)
+            {
+                const Event& event = events[i % events.size()];
+                copies.push_back({event.name.load(std::memory_order_relaxed), event.start_ns.load(std::memory_order_relaxed),
+                    event.duration_ns.load(std::memory_order_relaxed)});
+            }
+            // Slots the writer reused meanwhile may mix two events, skip them
+            std::atomic_thread_fence(std::memory_order_acquire);
+            const uint64_t now = head.load(std::memory_order_relaxed);
+            const uint64_t valid = now > events.size() ? now - events.size() + 1 : 0;
+            for (uint64_t i = std::max(begin, valid); i < end; ++i)
+            {
+                const Copy& c = copies[i - begin];
+                std::fprintf(file, ",\n{\"name\":\"%s\",\"ph\":\"X\",\"pid\":1,\"tid\":%u,\"ts\":%.3f,\"dur\":%.3f}",
+                    c.name, tid, c.start_ns / 1e3, c.duration_ns / 1e3);
+            }
+        }
+
+        const uint32_t tid;
+        const std::string name;
+        std::vector<Event> events;
+        std::atomic<uint64_t> head{0};
+    };
+
+    static Buffer* register_thread()
+    {
+        std::lock_guard<std::mutex> lock(registry_mutex_);
+        const uint32_t tid = static_cast<uint32_t>(buffers_.size() + 1);
+        buffers_.push_back(std::make_unique<Buffer>(tid, thread_name_.empty() ? fmt::format("thread {}", tid) : thread_name_, events_per_thread_));
+        return buffers_.back().get();
+    }
+
+    inline static std::atomic<bool> enabled_{false};
+    inline static std::atomic<bool> dump_requested_{false};
+    inline static size_t events_per_thread_{1 << 16};
+    inline static const Clock::time_point epoch_{Clock::now()};
+    // Buffers outlive their thread, the last events of finished threads are still dumped
+    inline static std::mutex registry_mutex_;
+    inline static std::vector<std::unique_ptr<Buffer>> buffers_;
+    inline static thread_local Buffer* local_buffer_{nullptr};
+    inline static thread_local std::string thread_name_;
+};
+
+// Records the lifetime of the scope as a trace event
+class ScopedTrace
+{
+public:
+    explicit ScopedTrace(const char* name) :
+        name_{Trace::enabled() ? name : nullptr}
+    {
+        if (name_)
+        {
+            start_ = Trace::Clock::now();
+        }
+    }
+
+    ~ScopedTrace()
+    {
+        if (name_)
+        {
+            Trace::record(name_, start_, Trace::Clock::now());
+        }
+    }
+
+    ScopedTrace(const ScopedTrace&) = delete;
+    ScopedTrace& operator=(const ScopedTrace&) = delete;
+
+private:
+    const char* name_;
+    Trace::Clock::time_point start_;
+};
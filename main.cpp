@@ -3,27 +3,61 @@
 #include "InferenceBackendSetup.hpp"
 #include "Logger.hpp"
 #include "utils.hpp"
+#include "PipelineExecutor.hpp"
+#include "MultiStreamServer.hpp"
+#include "ImageBatchProcessor.hpp"
+#include "ImageDecode.hpp"
+#include "BenchmarkRunner.hpp"
+#include "DetectionSink.hpp"
+#include "FrameRenderer.hpp"
+#include "Trace.hpp"
+#include <csignal>
 
 
 static const std::string params = "{ help h   |   | print help message }"
       "{ type     |  yolov9 | yolov4, yolov5, yolov6, yolov7,yolov8, yolov9, rtdetr, rtdetrul}"
-      "{ source s   |   | path to image or video source}"
+      "{ source s   |   | path to image or video source, or a directory, glob pattern or .txt list of images}"
       "{ labels lb  |  | path to class labels}"
       "{ config c   |   | optional model configuration file}"
       "{ weights w  |   | path to models weights}"
       "{ use_gpu   | false  | activate gpu support}"
-      "{ min_confidence | 0.25   | optional min confidence}";
+      "{ min_confidence | 0.25   | optional min confidence}"
+      "{ nms_top_k | 1000   | best scored candidates kept for non maximum suppression (0 keeps all)}"
+      "{ headless | false | no display, detections only go to --output}"
+      "{ output o | | detections output, stdout, a .bin file (binary records) or any other file (JSON lines)}"
+      "{ record | | annotated video output file}"
+      "{ record_fps | 30 | frame rate of the recorded video}"
+      "{ pipeline_depth | 4   | frames in flight in the video pipeline}"
+      "{ batch_size | 1   | frames per inference call in the video pipeline, max batch across streams in multi stream mode}"
+      "{ batch_timeout_ms | 5   | multi stream mode, max wait for a batch to fill}"
+      "{ throughput | false   | OpenVINO, compile with the THROUGHPUT performance hint}"
+      "{ num_streams | 0   | OpenVINO, number of inference streams (0 lets the plugin choose)}"
+      "{ num_threads | 0   | OpenVINO and ONNX Runtime, number of inference threads per engine (0 lets the runtime choose)}"
+      "{ latency_budget_ms | 0   | live sources, max capture to render latency, slower frames reuse the last detections or are dropped (0 disables)}"
+      "{ io_binding | false   | ONNX Runtime, run through an IoBinding with preallocated output buffers}"
+      "{ replicas | 1   | engine replicas serving requests concurrently, each with num_threads threads}"
+      "{ workers | 0   | batch image mode, decode and postprocess threads (0 uses one per hardware thread)}"
+      "{ annotate_dir | | batch image mode, directory for annotated JPEG copies of the images}"
+      "{ benchmark | false | time preprocess, inference and postprocess on in-memory frames (from --source or synthetic) and exit}"
+      "{ benchmark_warmup | 10 | benchmark mode, untimed iterations}"
+      "{ benchmark_iterations | 100 | benchmark mode, timed iterations of --batch_size frames}"
+      "{ benchmark_frames | 16 | benchmark mode, frames decoded from --source into memory}"
+      "{ benchmark_resolution | 1280x720 | benchmark mode without --source, synthetic frame size}"
+      "{ benchmark_json | benchmark.json | benchmark mode, results file}"
+      "{ trace | | Chrome trace-event JSON of the pipeline stages, written at exit (SIGUSR1 dumps it while running)}"
+      "{ alloc_check | 0 | video mode, abort on any allocation in preprocess or postprocess after this many warmup frames (needs -DCOUNT_ALLOCATIONS=ON, 0 disables)}";
 
 
 int main (int argc, char *argv[])
 {
-    initializeLogger();
+    // Command line parser
+    cv::CommandLineParser parser(argc, argv, params);
+
+    // Detections written to stdout, the console log goes to stderr
+    initializeLogger(parser.get<std::string>("output") == "stdout");
 
     // Use the logger for logging
     logger->info("Initializing application");
-
-    // Command line parser
-    cv::CommandLineParser parser(argc, argv, params);
     parser.about("Detect objets from video or image input source");
     if (parser.has("help")){
         parser.printMessage();
@@ -36,8 +70,29 @@ int main (int argc, char *argv[])
         std::exit(1);
     }
 
+    // Timeline of every stage on every thread, open in chrome://tracing or ui.perfetto.dev
+    struct TraceDump
+    {
+        std::string path;
+        ~TraceDump()
+        {
+            if (!path.empty() && !Trace::dump(path))
+            {
+                logger->error("Can't write trace to {}", path);
+            }
+        }
+    } trace_dump{parser.get<std::string>("trace")};
+    if (!trace_dump.path.empty())
+    {
+        Trace::enable();
+        Trace::set_thread_name("main");
+        std::signal(SIGUSR1, [](int) { Trace::request_dump(); });
+        logger->info("Tracing to {}", trace_dump.path);
+    }
+
     std::string source = parser.get<std::string>("source");
-    if (source.empty()){
+    const bool benchmark = parser.get<bool>("benchmark");
+    if (source.empty() && !benchmark){
         logger->error("Can not open video stream" );
         std::exit(1);
     }
@@ -77,7 +132,16 @@ int main (int argc, char *argv[])
     logger->info("Current path is {}", std::filesystem::current_path().c_str()); 
 
     Detector::SetLogger(logger);
-    std::unique_ptr<Detector> detector = createDetector(detectorType); 
+    const size_t nms_top_k = std::max(parser.get<int>("nms_top_k"), 0);
+    const auto make_detector = [&]() {
+        std::unique_ptr<Detector> detector = createDetector(detectorType);
+        if (detector)
+        {
+            detector->set_nms_top_k(nms_top_k);
+        }
+        return detector;
+    };
+    std::unique_ptr<Detector> detector = make_detector();
 
     if(!detector)
     {
@@ -86,7 +150,9 @@ int main (int argc, char *argv[])
     }
     
     InferenceInterface::SetLogger(logger);
-    std::unique_ptr<InferenceInterface> engine = setup_inference_engine(weights, config);
+    std::unique_ptr<InferenceInterface> engine = setup_inference_engine(weights, config,
+        parser.get<bool>("throughput"), parser.get<int>("num_streams"), parser.get<int>("num_threads"), parser.get<int>("replicas"),
+        parser.get<bool>("io_binding"));
     if(!engine)
     {
         logger->error("Can't setup an inference engine for{} {}", weights, config);
@@ -100,22 +166,191 @@ int main (int argc, char *argv[])
         std::exit(1);
     }
 
+    // Frames are decoded up front, only the detector and engine path is timed
+    if (benchmark)
+    {
+        std::vector<cv::Mat> frames;
+        std::vector<cv::Size> frame_sizes;
+        const size_t max_frames = std::max(parser.get<int>("benchmark_frames"), 1);
+        std::string input = source;
+        if (source.empty())
+        {
+            cv::Size size;
+            if (std::sscanf(parser.get<std::string>("benchmark_resolution").c_str(), "%dx%d", &size.width, &size.height) != 2 || size.empty())
+            {
+                logger->error("Invalid benchmark resolution {}", parser.get<std::string>("benchmark_resolution"));
+                std::exit(1);
+            }
+            frames.push_back(synthetic_frame(size));
+            input = fmt::format("synthetic {}x{}", size.width, size.height);
+        }
+        else if (is_image_batch_source(source) || source.find(".jpg") != std::string::npos || source.find(".png") != std::string::npos)
+        {
+            const std::vector<std::string> images = is_image_batch_source(source) ? list_images(source) : std::vector<std::string>{source};
+            for (size_t i = 0; i < images.size() && frames.size() < max_frames; ++i)
+            {
+                // Decoded like the batch image mode, large JPEGs at a reduced scale
+                cv::Size image_size;
+                cv::Mat image = decode_image(images[i], detector->network_size(), image_size);
+                if (!image.empty())
+                {
+                    frames.push_back(image);
+                    frame_sizes.push_back(image_size);
+                }
+            }
+        }
+        else
+        {
+            std::unique_ptr<VideoCaptureInterface> capture = createVideoInterface();
+            if (!capture->initialize(source)) {
+                logger->error("Failed to initialize video capture for input: {}", source);
+                return 1;
+            }
+            cv::Mat frame;
+            while (frames.size() < max_frames && capture->readFrame(frame) && !frame.empty())
+            {
+                frames.push_back(frame.clone());
+            }
+            capture->release();
+        }
+        if (frames.empty())
+        {
+            logger->error("No frames to benchmark from {}", source);
+            std::exit(1);
+        }
+
+        BenchmarkRunner runner(*detector, *engine, std::move(frames), std::max(parser.get<int>("batch_size"), 1), std::move(frame_sizes));
+        const BenchmarkResult result = runner.run(std::max(parser.get<int>("benchmark_warmup"), 0), std::max(parser.get<int>("benchmark_iterations"), 1));
+        result.log(*logger);
+        const std::string json_path = parser.get<std::string>("benchmark_json");
+        std::ofstream json(json_path);
+        json << result.to_json({detectorType, inference_backend_name(), weights, input});
+        if (!json)
+        {
+            logger->error("Can't write benchmark results to {}", json_path);
+            std::exit(1);
+        }
+        logger->info("Benchmark results written to {}", json_path);
+        return 0;
+    }
+
+    // Comma separated sources: one process serves them all, batching frames across streams
+    if (source.find(',') != std::string::npos)
+    {
+        std::vector<std::unique_ptr<VideoCaptureInterface>> sources;
+        std::stringstream sources_list(source);
+        std::string stream_source;
+        while (std::getline(sources_list, stream_source, ','))
+        {
+            std::unique_ptr<VideoCaptureInterface> capture = createVideoInterface();
+            if (!capture->initialize(stream_source)) {
+                logger->error("Failed to initialize video capture for input: {}", stream_source);
+                return 1;
+            }
+            sources.push_back(std::move(capture));
+        }
+
+        const int batch_size = std::max(parser.get<int>("batch_size"), 1);
+        const int batch_timeout_ms = std::max(parser.get<int>("batch_timeout_ms"), 0);
+        logger->info("Serving {} streams, max batch {} (engine limit {}), batch timeout {} ms", sources.size(), batch_size, engine->max_batch_size(), batch_timeout_ms);
+        MultiStreamServer::SetLogger(logger);
+        DetectionSink::SetLogger(logger);
+        const std::string output = parser.get<std::string>("output");
+        std::unique_ptr<DetectionSink> sink = output.empty() ? nullptr : create_detection_sink(output, classes, sources.size());
+        // Detectors keep per frame state between preprocess and postprocess, one per stream
+        MultiStreamServer server(std::move(sources), make_detector, *engine,
+            std::min<size_t>(batch_size, engine->max_batch_size()), std::chrono::milliseconds(batch_timeout_ms));
+        server.run([&](size_t stream, uint64_t frame_index, const cv::Mat&, const std::vector<Detection>& detections)
+        {
+            if (!trace_dump.path.empty())
+            {
+                Trace::dump_if_requested(trace_dump.path);
+            }
+            if (sink)
+            {
+                sink->write(stream, static_cast<uint32_t>(stream), frame_index, detections);
+            }
+            for (const auto& d : detections)
+            {
+                logger->debug("Stream {} frame {}: {} {:.2f} [{}, {}, {}, {}]", stream, frame_index, classes[d.label], d.score, d.bbox.x, d.bbox.y, d.bbox.width, d.bbox.height);
+            }
+        });
+        return 0;
+    }
+
+    // Image archives: parallel decode, batched inference, detections to --output (default data/detections.jsonl)
+    if (is_image_batch_source(source))
+    {
+        std::vector<std::string> images = list_images(source);
+        if (images.empty())
+        {
+            logger->error("No images found in {}", source);
+            std::exit(1);
+        }
+
+        const int batch_size = std::max(parser.get<int>("batch_size"), 1);
+        const int batch_timeout_ms = std::max(parser.get<int>("batch_timeout_ms"), 0);
+        const int workers = parser.get<int>("workers") > 0 ? parser.get<int>("workers") : std::max<int>(std::thread::hardware_concurrency(), 1);
+        logger->info("Processing {} images with {} workers, max batch {} (engine limit {})", images.size(), workers, batch_size, engine->max_batch_size());
+        const std::string output = parser.get<std::string>("output");
+        DetectionSink::SetLogger(logger);
+        std::unique_ptr<DetectionSink> sink = create_detection_sink(output.empty() ? "data/detections.jsonl" : output, classes, workers);
+        ImageBatchProcessor::SetLogger(logger);
+        ImageBatchProcessor processor(std::move(images), make_detector, *engine, sink.get(), classes,
+            parser.get<std::string>("annotate_dir"), workers, std::min<size_t>(batch_size, engine->max_batch_size()),
+            std::chrono::milliseconds(batch_timeout_ms));
+        processor.run();
+        if (sink->dropped() > 0)
+        {
+            logger->error("Detection sink dropped {} records, the output is incomplete", sink->dropped());
+            std::exit(1);
+        }
+        return 0;
+    }
+
     if (source.find(".jpg") != std::string::npos || source.find(".png") != std::string::npos) 
     {
-        cv::Mat image = cv::imread(source);
+        // Boxes come in full resolution coordinates, the image may be decoded at a reduced scale
+        cv::Size frame_size;
+        cv::Mat image = decode_image(source, detector->network_size(), frame_size);
+        if (image.empty())
+        {
+            logger->error("Can't decode image {}", source);
+            std::exit(1);
+        }
         auto start = std::chrono::steady_clock::now();
-        const auto input_blob = detector->preprocess_image(image);
-        const auto[outputs, shapes] = engine->get_infer_results(input_blob);
-        std::vector<Detection> detections = detector->postprocess(outputs, shapes, image.size());
+        cv::Mat& input_blob = engine->get_input_blob();
+        {
+            ScopedStageTimer timer(Stage::Preprocess);
+            detector->preprocess_image(image, input_blob);
+        }
+        std::vector<TensorView> outputs;
+        {
+            ScopedStageTimer timer(Stage::Inference);
+            outputs = engine->get_infer_results(input_blob);
+        }
+        std::vector<Detection> detections;
+        {
+            ScopedStageTimer timer(Stage::Postprocess);
+            detections = detector->postprocess(outputs, frame_size);
+        }
         auto end = std::chrono::steady_clock::now();
-        auto duration = std::chrono::duration_cast<std::chrono::milliseconds>(end - start).count();
-        logger->info("Inference time: {} ms", duration);
+        logger->info("Inference time: {:.3f} ms", std::chrono::duration<double, std::milli>(end - start).count());
+        StageTimers::log(*logger);
+        // The output keeps the source resolution, a reduced decode only fed the network
+        cv::Mat output = image.size() == frame_size ? image : cv::imread(source);
+        if (output.empty())
+        {
+            output = image;
+        }
+        const double scale = static_cast<double>(output.cols) / frame_size.width;
         for (const auto& d : detections) 
         {
-            cv::rectangle(image, d.bbox, cv::Scalar(255, 0, 0), 3);
-            draw_label(image, classes[d.label], d.score, d.bbox.x, d.bbox.y);
+            const cv::Rect box(cvRound(d.bbox.x * scale), cvRound(d.bbox.y * scale), cvRound(d.bbox.width * scale), cvRound(d.bbox.height * scale));
+            cv::rectangle(output, box, cv::Scalar(255, 0, 0), 3);
+            draw_label(output, classes[d.label], d.score, box.x, box.y);
         }        
-        cv::imwrite("data/processed.png", image);
+        cv::imwrite("data/processed.png", output);
         return 0;
     }
 
@@ -126,29 +361,77 @@ int main (int argc, char *argv[])
         return 1;
     }    
 
-    cv::Mat frame;
-    while ( videoInterface->readFrame(frame)) 
+    // Capture, preprocess, inference and postprocess overlap on their own threads, rendering stays here
+    const int pipeline_depth = parser.get<int>("pipeline_depth");
+    const int batch_size = parser.get<int>("batch_size");
+    logger->info("Pipeline depth {}, batch size {} (engine limit {})", pipeline_depth, batch_size, engine->max_batch_size());
+    const int latency_budget_ms = std::max(parser.get<int>("latency_budget_ms"), 0);
+    PipelineExecutor pipeline(*videoInterface, *detector, *engine, std::max(pipeline_depth, 1), std::max(batch_size, 1),
+        std::chrono::milliseconds(latency_budget_ms));
+
+    // Detections are written by a background thread, headless mode skips drawing and the display entirely
+    const bool headless = parser.get<bool>("headless");
+    const std::string output = parser.get<std::string>("output");
+    DetectionSink::SetLogger(logger);
+    std::unique_ptr<DetectionSink> sink = output.empty() ? nullptr : create_detection_sink(output, classes);
+    // Annotation, display and recording run on the renderer threads, off the inference path
+    const std::string record = parser.get<std::string>("record");
+    FrameRenderer::SetLogger(logger);
+    std::unique_ptr<FrameRenderer> renderer = headless && record.empty() ? nullptr :
+        std::make_unique<FrameRenderer>(classes, !headless, record, parser.get<double>("record_fps"));
+    // Test mode for the zero allocation steady state
+    const int alloc_check = std::max(parser.get<int>("alloc_check"), 0);
+    if (alloc_check > 0 && !AllocationCounter::enabled())
     {
-        auto start = std::chrono::steady_clock::now();
-        const auto input_blob = detector->preprocess_image(frame);
-        const auto[outputs, shapes] = engine->get_infer_results(input_blob);
-        std::vector<Detection> detections = detector->postprocess(outputs, shapes, frame.size());
-        auto end = std::chrono::steady_clock::now();
-        auto duration = std::chrono::duration_cast<std::chrono::milliseconds>(end - start).count();
-        double fps = 1000.0 / duration;
-        std::string fpsText = "FPS: " + std::to_string(fps);
-        cv::putText(frame, fpsText, cv::Point(10, 30), cv::FONT_HERSHEY_SIMPLEX, 1, cv::Scalar(0, 255, 0), 2);
-        for (const auto& d : detections) {
-            cv::rectangle(frame, d.bbox, cv::Scalar(255, 0, 0), 3);
-            draw_label(frame, classes[d.label], d.score, d.bbox.x, d.bbox.y);
-        }
-
-        cv::imshow("opencv feed", frame);
-        char key = cv::waitKey(1);
-        if (key == 27 || key == 'q') {
+        logger->error("--alloc_check needs a build with -DCOUNT_ALLOCATIONS=ON");
+        std::exit(1);
+    }
+    const auto start = std::chrono::steady_clock::now();
+    // Per stage latency percentiles, every few seconds and at the end
+    const auto stats_period = std::chrono::seconds(10);
+    auto next_stats = start + stats_period;
+    uint64_t frames = 0;
+    pipeline.run([&](uint64_t frame_index, cv::Mat& frame, const std::vector<Detection>& detections)
+    {
+        ++frames;
+        if (alloc_check > 0 && frames == static_cast<uint64_t>(alloc_check))
+        {
+            logger->info("Warmup done, checking for allocations in preprocess and postprocess");
+            AllocationCounter::start_checking();
+        }
+        const auto now = std::chrono::steady_clock::now();
+        if (now >= next_stats)
+        {
+            StageTimers::log(*logger);
+            next_stats = now + stats_period;
+        }
+        if (!trace_dump.path.empty())
+        {
+            Trace::dump_if_requested(trace_dump.path);
+        }
+        if (sink)
+        {
+            sink->write(0, 0, frame_index, detections);
+        }
+        if (!renderer)
+        {
+            return true;
+        }
+        renderer->submit(frame, detections);
+        if (renderer->stop_requested()) {
             logger->info("Exit requested");
-            break;
+            return false;
         }
+        return true;
+    });
+    renderer.reset();
+    const double elapsed = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+    logger->info("{} frames in {:.2f} s, {:.1f} FPS", frames, elapsed, elapsed > 0 ? frames / elapsed : 0.0);
+    StageTimers::log(*logger);
+    if (pipeline.scheduler().enabled())
+    {
+        const FrameScheduler& scheduler = pipeline.scheduler();
+        logger->info("Frames processed {}, reused {}, skipped {}, late {}", scheduler.processed(), scheduler.reused(), scheduler.skipped(), scheduler.late());
     }
     
     videoInterface->release();
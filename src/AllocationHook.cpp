@@ -0,0 +1,146 @@
+#include "StageTimers.hpp"
+#include <new>
+
+// Only built with -DCOUNT_ALLOCATIONS=ON: replaces the global operator new (plain, nothrow and
+// aligned forms) and the default cv::Mat allocator to feed AllocationCounter. The replacements forward
+// to malloc / aligned_alloc and the standard OpenCV allocator, counting costs a few thread local
+// increments per allocation.
+
+void* operator new(std::size_t size)
+{
+    AllocationCounter::on_allocation(size);
+    if (void* p = std::malloc(size ? size : 1))
+    {
+        return p;
+    }
+    throw std::bad_alloc();
+}
+
+void* operator new[](std::size_t size)
+{
+    return operator new(size);
+}
+
+void* operator new(std::size_t size, const std::nothrow_t&) noexcept
+{
+    AllocationCounter::on_allocation(size);
+    return std::malloc(size ? size : 1);
+}
+
+void* operator new[](std::size_t size, const std::nothrow_t& tag) noexcept
+{
+    return operator new(size, tag);
+}
+
+void operator delete(void* p) noexcept
+{
+    std::free(p);
+}
+
+void operator delete[](void* p) noexcept
+{
+    std::free(p);
+}
+
+void operator delete(void* p, std::size_t) noexcept
+{
+    std::free(p);
+}
+
+void operator delete[](void* p, std::size_t) noexcept
+{
+    std::free(p);
+}
+
+// Over-aligned types (alignas above the default new alignment) go through these
+void* operator new(std::size_t size, std::align_val_t alignment)
+{
+    AllocationCounter::on_allocation(size);
+    // aligned_alloc wants a size multiple of the alignment
+    const std::size_t align = static_cast<std::size_t>(alignment);
+    if (void* p = std::aligned_alloc(align, (std::max<std::size_t>(size, 1) + align - 1) / align * align))
+    {
+        return p;
+    }
+    throw std::bad_alloc();
+}
+
+void* operator new[](std::size_t size, std::align_val_t alignment)
+{
+    return operator new(size, alignment);
+}
+
+void* operator new(std::size_t size, std::align_val_t alignment, const std::nothrow_t&) noexcept
+{
+    try
+    {
+        return operator new(size, alignment);
+    }
+    catch (const std::bad_alloc&)
+    {
+        return nullptr;
+    }
+}
+
+void* operator new[](std::size_t size, std::align_val_t alignment, const std::nothrow_t& tag) noexcept
+{
+    return operator new(size, alignment, tag);
+}
+
+void operator delete(void* p, std::align_val_t) noexcept
+{
+    std::free(p);
+}
+
+void operator delete[](void* p, std::align_val_t) noexcept
+{
+    std::free(p);
+}
+
+void operator delete(void* p, std::size_t, std::align_val_t) noexcept
+{
+    std::free(p);
+}
+
+void operator delete[](void* p, std::size_t, std::align_val_t) noexcept
+{
+    std::free(p);
+}
+
+
+namespace
+{
+    // cv::Mat data comes from cv::fastMalloc, not operator new. The standard allocator creates the
+    // UMatData header with new (counted there), only the data bytes are added here.
+    class CountingMatAllocator : public cv::MatAllocator
+    {
+    public:
+        cv::UMatData* allocate(int dims, const int* sizes, int type, void* data, size_t* step,
+            cv::AccessFlag flags, cv::UMatUsageFlags usage) const override
+        {
+            cv::UMatData* u = cv::Mat::getStdAllocator()->allocate(dims, sizes, type, data, step, flags, usage);
+            if (u && !data)
+            {
+                AllocationCounter::on_bytes(u->size);
+            }
+            return u;
+        }
+
+        bool allocate(cv::UMatData* u, cv::AccessFlag flags, cv::UMatUsageFlags usage) const override
+        {
+            return cv::Mat::getStdAllocator()->allocate(u, flags, usage);
+        }
+
+        void deallocate(cv::UMatData* u) const override
+        {
+            cv::Mat::getStdAllocator()->deallocate(u);
+        }
+    };
+
+    const bool mat_allocator_installed = []()
+    {
+        static CountingMatAllocator allocator;
+        cv::Mat::setDefaultAllocator(&allocator);
+        return true;
+    }();
+}
@@ -0,0 +1,108 @@
+#include "DecodeUtils.hpp"
+#if defined(__AVX2__) || defined(__SSE4_1__)
+#include <immintrin.h>
+#endif
+
+
+void update_class_max(const float* scores, int class_id, float* max_scores, int* max_classes, int n)
+{
+    int i = 0;
+#if defined(__AVX2__)
+    const __m256i vclass = _mm256_set1_epi32(class_id);
+    for (; i + 8 <= n; i += 8)
+    {
+        const __m256 s = _mm256_loadu_ps(scores + i);
+        const __m256 m = _mm256_loadu_ps(max_scores + i);
+        const __m256 greater = _mm256_cmp_ps(s, m, _CMP_GT_OQ);
+        const __m256i k = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(max_classes + i));
+        _mm256_storeu_ps(max_scores + i, _mm256_blendv_ps(m, s, greater));
+        _mm256_storeu_si256(reinterpret_cast<__m256i*>(max_classes + i), _mm256_blendv_epi8(k, vclass, _mm256_castps_si256(greater)));
+    }
+#elif defined(__SSE4_1__)
+    const __m128i vclass = _mm_set1_epi32(class_id);
+    for (; i + 4 <= n; i += 4)
+    {
+        const __m128 s = _mm_loadu_ps(scores + i);
+        const __m128 m = _mm_loadu_ps(max_scores + i);
+        const __m128 greater = _mm_cmpgt_ps(s, m);
+        const __m128i k = _mm_loadu_si128(reinterpret_cast<const __m128i*>(max_classes + i));
+        _mm_storeu_ps(max_scores + i, _mm_blendv_ps(m, s, greater));
+        _mm_storeu_si128(reinterpret_cast<__m128i*>(max_classes + i), _mm_blendv_epi8(k, vclass, _mm_castps_si128(greater)));
+    }
+#endif
+    for (; i < n; ++i)
+    {
+        if (scores[i] > max_scores[i])
+        {
+            max_scores[i] = scores[i];
+            max_classes[i] = class_id;
+        }
+    }
+}
+
+
+void select_above_threshold(const float* scores, int n, float threshold, std::vector<int>& indices)
+{
+    indices.clear();
+    int i = 0;
+#if defined(__AVX2__)
+    const __m256 vthreshold = _mm256_set1_ps(threshold);
+    for (; i + 8 <= n; i += 8)
+    {
+        int mask = _mm256_movemask_ps(_mm256_cmp_ps(_mm256_loadu_ps(scores + i), vthreshold, _CMP_GT_OQ));
+        while (mask)
+        {
+            indices.push_back(i + __builtin_ctz(mask));
+            mask &= mask - 1;
+        }
+    }
+#elif defined(__SSE4_1__)
+    const __m128 vthreshold = _mm_set1_ps(threshold);
+    for (; i + 4 <= n; i += 4)
+    {
+        int mask = _mm_movemask_ps(_mm_cmpgt_ps(_mm_loadu_ps(scores + i), vthreshold));
+        while (mask)
+        {
+            indices.push_back(i + __builtin_ctz(mask));
+            mask &= mask - 1;
+        }
+    }
+#endif
+    for (; i < n; ++i)
+    {
+        if (scores[i] > threshold)
+        {
+            indices.push_back(i);
+        }
+    }
+}
+
+
+void select_strided_above_threshold(const float* scores, int stride, int n, float threshold, std::vector<int>& indices)
+{
+    indices.clear();
+    int i = 0;
+#if defined(__AVX2__)
+    const __m256 vthreshold = _mm256_set1_ps(threshold);
+    const __m256i vstep = _mm256_set1_epi32(8 * stride);
+    __m256i offsets = _mm256_mullo_epi32(_mm256_setr_epi32(0, 1, 2, 3, 4, 5, 6, 7), _mm256_set1_epi32(stride));
+    for (; i + 8 <= n; i += 8)
+    {
+        const __m256 s = _mm256_i32gather_ps(scores, offsets, 4);
+        int mask = _mm256_movemask_ps(_mm256_cmp_ps(s, vthreshold, _CMP_GT_OQ));
+        while (mask)
+        {
+            indices.push_back(i + __builtin_ctz(mask));
+            mask &= mask - 1;
+        }
+        offsets = _mm256_add_epi32(offsets, vstep);
+    }
+#endif
+    for (; i < n; ++i)
+    {
+        if (scores[static_cast<size_t>(i) * stride] > threshold)
+        {
+            indices.push_back(i);
+        }
+    }
+}
@@ -0,0 +1,16 @@
+#pragma once
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+// Vectorized building blocks for decoding raw detection heads (AVX2 / SSE4.1, scalar fallback)
+
+// For a contiguous row of n scores belonging to class_id: max_scores[i] = max(max_scores[i], scores[i]),
+// max_classes[i] is set to class_id where the score is strictly greater (first max wins, as std::max_element)
+void update_class_max(const float* scores, int class_id, float* max_scores, int* max_classes, int n);
+
+// Replace the content of indices with the positions i in [0, n) where scores[i] > threshold
+void select_above_threshold(const float* scores, int n, float threshold, std::vector<int>& indices);
+
+// Same as select_above_threshold for a strided column, scores[i * stride] (e.g. the objectness of row major heads)
+void select_strided_above_threshold(const float* scores, int stride, int n, float threshold, std::vector<int>& indices);
@@ -1,10 +1,11 @@
 #include "Detector.hpp"
+#include "StageTimers.hpp"
 
 
 std::shared_ptr<spdlog::logger> Detector::logger_;
 
 
-cv::Rect Detector::get_rect(const cv::Size& imgSz, const std::vector<float>& bbox)
+cv::Rect Detector::get_rect(const cv::Size& imgSz, const float* bbox)
 {
     float r_w = network_width_ / static_cast<float>(imgSz.width);
     float r_h = network_height_ / static_cast<float>(imgSz.height);
@@ -40,3 +41,48 @@ cv::Rect Detector::get_rect(const cv::Size& imgSz, const std::vector<float>& bbo
     return cv::Rect(l, t, r - l, b - t);
 }
 
+
+
+void Detector::reserve_candidates(size_t max_candidates, std::vector<Detection>& detections)
+{
+    boxes_.reserve(max_candidates);
+    nms_.reserve(max_candidates);
+    const size_t top_k = nms_.top_k();
+    detections.reserve(top_k > 0 ? std::min(max_candidates, top_k) : max_candidates);
+}
+
+
+void Detector::apply_nms(const BoxCandidates& candidates, std::vector<Detection>& detections, bool class_aware)
+{
+    ScopedStageTimer timer(Stage::Nms);
+    const std::vector<int>& indices = nms_.run(candidates, nms_threshold_, class_aware);
+    detections.clear();
+    detections.reserve(indices.size());
+    for (const int idx : indices)
+    {
+        Detection det;
+        det.bbox = cv::Rect(cv::Point(candidates.x1[idx], candidates.y1[idx]), cv::Point(candidates.x2[idx], candidates.y2[idx]));
+        det.score = candidates.scores[idx];
+        det.label = candidates.class_ids[idx];
+        detections.emplace_back(det);
+    }
+}
+
+
+std::vector<Detection> Detector::postprocess(const std::vector<TensorView>& outputs, const cv::Size& frame_size)
+{
+    std::vector<Detection> detections;
+    postprocess(outputs, frame_size, detections);
+    return detections;
+}
+
+
+std::vector<std::vector<Detection>> Detector::postprocess_batch(const std::vector<std::vector<TensorView>>& outputs, const std::vector<cv::Size>& frame_sizes)
+{
+    std::vector<std::vector<Detection>> detections(outputs.size());
+    for (size_t i = 0; i < outputs.size(); ++i)
+    {
+        postprocess(outputs[i], frame_sizes[i], detections[i]);
+    }
+    return detections;
+}
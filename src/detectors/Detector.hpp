@@ -1,5 +1,7 @@
 #pragma once
 #include "common.hpp"
+#include "TensorView.hpp"
+#include "NonMaxSuppression.hpp"
 
 struct Detection
 {
@@ -18,7 +20,15 @@ protected:
 	static std::shared_ptr<spdlog::logger> logger_; // Logger instance
     int channels_{ -1 };
 
-	cv::Rect get_rect(const cv::Size& imgSz, const std::vector<float>& bbox);
+	NonMaxSuppression nms_;
+	BoxCandidates boxes_;	// Decoded candidates scratch, reused across frames
+
+	cv::Rect get_rect(const cv::Size& imgSz, const float* bbox);
+	// Sizes the candidates, NMS and detections storage from the output shape (max_candidates boxes
+	// per image), so the first decode allocates for the worst case rather than the busiest frame seen
+	void reserve_candidates(size_t max_candidates, std::vector<Detection>& detections);
+	// Keeps the best boxes of the candidates (per class when class_aware) in detections
+	void apply_nms(const BoxCandidates& candidates, std::vector<Detection>& detections, bool class_aware = false);
 
 
 public:
@@ -36,8 +46,28 @@ public:
     {
     	logger_ = logger;
     }
-	virtual std::vector<Detection> postprocess(const std::vector<std::vector<std::any>>& outputs, const std::vector<std::vector<int64_t>>& shapes, const cv::Size& frame_size) = 0;
-    virtual cv::Mat preprocess_image(const cv::Mat& image) = 0; 
+	// Candidates kept for NMS, the best top_k by score (0 keeps all of them)
+	void set_nms_top_k(size_t top_k)
+	{
+		nms_.set_top_k(top_k);
+	}
+	// Input resolution frames are resized to, callers may decode large images at a reduced scale
+	cv::Size network_size() const
+	{
+		return cv::Size(static_cast<int>(network_width_), static_cast<int>(network_height_));
+	}
+	// Boxes are mapped to frame_size, which may be larger than the preprocessed image (reduced decode)
+	// as long as the aspect ratio is the same. detections is overwritten, callers that keep it across
+	// frames (frame slots) reuse its capacity, so the steady state doesn't allocate.
+	virtual void postprocess(const std::vector<TensorView>& outputs, const cv::Size& frame_size, std::vector<Detection>& detections) = 0;
+	std::vector<Detection> postprocess(const std::vector<TensorView>& outputs, const cv::Size& frame_size);
+	// Decodes every image of a batch, outputs[i] are image i's slices of the batched outputs
+	// (see InferenceInterface::get_infer_results_batch), laid out as a batch 1 output
+	std::vector<std::vector<Detection>> postprocess_batch(const std::vector<std::vector<TensorView>>& outputs, const std::vector<cv::Size>& frame_sizes);
+    // Writes the network input blob into blob, its memory is reused when shape and type already match.
+    // The pipelined video loop runs preprocess_image and postprocess of different frames concurrently,
+    // so they must not share mutable state.
+    virtual void preprocess_image(const cv::Mat& image, cv::Mat& blob) = 0; 
 
 
 };
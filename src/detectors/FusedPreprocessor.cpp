@@ -0,0 +1,203 @@
+#include "FusedPreprocessor.hpp"
+#if defined(__AVX2__) || defined(__SSE4_1__)
+#include <immintrin.h>
+#endif
+
+namespace
+{
+    // Same sample mapping as cv::resize INTER_LINEAR (half pixel centers, clamped borders)
+    void compute_coeffs(int src_len, int dst_len, int step,
+        std::vector<int>& ofs0, std::vector<int>& ofs1, std::vector<float>& weights)
+    {
+        ofs0.resize(dst_len);
+        ofs1.resize(dst_len);
+        weights.resize(dst_len);
+        const double inv_scale = static_cast<double>(src_len) / dst_len;
+        for (int d = 0; d < dst_len; ++d)
+        {
+            const float f = static_cast<float>((d + 0.5) * inv_scale - 0.5);
+            int s = static_cast<int>(std::floor(f));
+            float w = f - s;
+            if (s < 0)
+            {
+                s = 0;
+                w = 0.f;
+            }
+            if (s >= src_len - 1)
+            {
+                s = src_len - 1;
+                w = 0.f;
+            }
+            ofs0[d] = s * step;
+            ofs1[d] = std::min(s + 1, src_len - 1) * step;
+            weights[d] = w;
+        }
+    }
+}
+
+
+FusedPreprocessor::FusedPreprocessor(
+    int network_width,
+    int network_height,
+    bool letterbox,
+    bool swap_rb,
+    float scale,
+    float pad_value) :
+    network_width_{network_width},
+    network_height_{network_height},
+    letterbox_{letterbox},
+    src_channel_{swap_rb ? 2 : 0, 1, swap_rb ? 0 : 2},
+    scale_{scale},
+    pad_value_{pad_value}
+{
+}
+
+
+void FusedPreprocessor::update_tables(const cv::Size& src_size)
+{
+    src_size_ = src_size;
+    roi_ = cv::Rect(0, 0, network_width_, network_height_);
+    if (letterbox_)
+    {
+        float r_w = network_width_ / (src_size.width * 1.0);
+        float r_h = network_height_ / (src_size.height * 1.0);
+        if (r_h > r_w) {
+            roi_.height = r_w * src_size.height;
+            roi_.y = (network_height_ - roi_.height) / 2;
+        } else {
+            roi_.width = r_h * src_size.width;
+            roi_.x = (network_width_ - roi_.width) / 2;
+        }
+    }
+
+    compute_coeffs(src_size.width, roi_.width, 3, xofs0_, xofs1_, alpha_);
+    compute_coeffs(src_size.height, roi_.height, 1, yofs0_, yofs1_, beta_);
+    row_.resize(src_size.width * 3);
+}
+
+
+void FusedPreprocessor::vertical_pass(const uchar* r0, const uchar* r1, float beta, int n)
+{
+    float* row = row_.data();
+    int i = 0;
+#if defined(__AVX2__)
+    const __m256 vbeta = _mm256_set1_ps(beta);
+    for (; i + 8 <= n; i += 8)
+    {
+        const __m256 a = _mm256_cvtepi32_ps(_mm256_cvtepu8_epi32(_mm_loadl_epi64(reinterpret_cast<const __m128i*>(r0 + i))));
+        const __m256 b = _mm256_cvtepi32_ps(_mm256_cvtepu8_epi32(_mm_loadl_epi64(reinterpret_cast<const __m128i*>(r1 + i))));
+        _mm256_storeu_ps(row + i, _mm256_add_ps(a, _mm256_mul_ps(_mm256_sub_ps(b, a), vbeta)));
+    }
+#elif defined(__SSE4_1__)
+    const __m128 vbeta = _mm_set1_ps(beta);
+    for (; i + 4 <= n; i += 4)
+    {
+        int32_t pa, pb;
+        std::memcpy(&pa, r0 + i, sizeof(pa));
+        std::memcpy(&pb, r1 + i, sizeof(pb));
+        const __m128 a = _mm_cvtepi32_ps(_mm_cvtepu8_epi32(_mm_cvtsi32_si128(pa)));
+        const __m128 b = _mm_cvtepi32_ps(_mm_cvtepu8_epi32(_mm_cvtsi32_si128(pb)));
+        _mm_storeu_ps(row + i, _mm_add_ps(a, _mm_mul_ps(_mm_sub_ps(b, a), vbeta)));
+    }
+#endif
+    for (; i < n; ++i)
+    {
+        const float a = r0[i];
+        row[i] = a + (r1[i] - a) * beta;
+    }
+}
+
+
+void FusedPreprocessor::horizontal_pass(float* const out[3], int x0)
+{
+    const float* row = row_.data();
+    const int n = roi_.width;
+    int x = 0;
+#if defined(__AVX2__)
+    const __m256 vscale = _mm256_set1_ps(scale_);
+    for (; x + 8 <= n; x += 8)
+    {
+        const __m256i i0 = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(xofs0_.data() + x));
+        const __m256i i1 = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(xofs1_.data() + x));
+        const __m256 a = _mm256_loadu_ps(alpha_.data() + x);
+        for (int c = 0; c < 3; ++c)
+        {
+            const float* base = row + src_channel_[c];
+            const __m256 v0 = _mm256_i32gather_ps(base, i0, 4);
+            const __m256 v1 = _mm256_i32gather_ps(base, i1, 4);
+            const __m256 v = _mm256_add_ps(v0, _mm256_mul_ps(_mm256_sub_ps(v1, v0), a));
+            _mm256_storeu_ps(out[c] + x0 + x, _mm256_mul_ps(v, vscale));
+        }
+    }
+#endif
+    for (; x < n; ++x)
+    {
+        const float a = alpha_[x];
+        for (int c = 0; c < 3; ++c)
+        {
+            const float v0 = row[xofs0_[x] + src_channel_[c]];
+            const float v1 = row[xofs1_[x] + src_channel_[c]];
+            out[c][x0 + x] = (v0 + (v1 - v0) * a) * scale_;
+        }
+    }
+}
+
+
+void FusedPreprocessor::run(const cv::Mat& image, cv::Mat& blob)
+{
+    const cv::Mat* src = &image;
+    if (image.type() != CV_8UC3)
+    {
+        cv::cvtColor(image, converted_, image.channels() == 1 ? cv::COLOR_GRAY2BGR : cv::COLOR_BGRA2BGR);
+        src = &converted_;
+    }
+    if (src->size() != src_size_)
+    {
+        update_tables(src->size());
+    }
+
+    // No-op when the blob (e.g. the engine input arena) already has the right shape
+    const int dims[] = { 1, 3, network_height_, network_width_ };
+    blob.create(4, dims, CV_32F);
+
+    const size_t plane_size = static_cast<size_t>(network_width_) * network_height_;
+    float* planes[3];
+    for (int c = 0; c < 3; ++c)
+    {
+        planes[c] = blob.ptr<float>() + c * plane_size;
+    }
+
+    // Letterbox padding, top and bottom bands then left and right margins per row
+    const float pad = pad_value_ * scale_;
+    const int bottom = roi_.y + roi_.height;
+    const int right = roi_.x + roi_.width;
+    for (int c = 0; c < 3; ++c)
+    {
+        std::fill(planes[c], planes[c] + static_cast<size_t>(roi_.y) * network_width_, pad);
+        std::fill(planes[c] + static_cast<size_t>(bottom) * network_width_, planes[c] + plane_size, pad);
+    }
+
+    const int n = src->cols * 3;
+    int last_y0 = -1, last_y1 = -1;
+    float last_beta = -1.f;
+    for (int y = 0; y < roi_.height; ++y)
+    {
+        // Upscaling maps consecutive output rows to the same taps, reuse the interpolated row
+        if (yofs0_[y] != last_y0 || yofs1_[y] != last_y1 || beta_[y] != last_beta)
+        {
+            vertical_pass(src->ptr<uchar>(yofs0_[y]), src->ptr<uchar>(yofs1_[y]), beta_[y], n);
+            last_y0 = yofs0_[y];
+            last_y1 = yofs1_[y];
+            last_beta = beta_[y];
+        }
+
+        float* out[3];
+        for (int c = 0; c < 3; ++c)
+        {
+            out[c] = planes[c] + static_cast<size_t>(roi_.y + y) * network_width_;
+            std::fill(out[c], out[c] + roi_.x, pad);
+            std::fill(out[c] + right, out[c] + network_width_, pad);
+        }
+        horizontal_pass(out, roi_.x);
+    }
+}
@@ -0,0 +1,44 @@
+#pragma once
+#include "common.hpp"
+
+// Single pass network input preparation: reads the BGR frame once and writes the planar
+// float blob (1 x 3 x H x W) doing bilinear resize, optional letterbox padding,
+// channel swap and scaling on the fly. Resize tables are cached per source size,
+// so steady state frames don't allocate.
+class FusedPreprocessor
+{
+public:
+    FusedPreprocessor(
+        int network_width,
+        int network_height,
+        bool letterbox,
+        bool swap_rb = true,
+        float scale = 1.f / 255.f,
+        float pad_value = 128.f);
+
+    void run(const cv::Mat& image, cv::Mat& blob);
+
+    // Region of the network input covered by the resized frame, the rest is padding
+    const cv::Rect& content_rect() const { return roi_; }
+
+private:
+    void update_tables(const cv::Size& src_size);
+    void vertical_pass(const uchar* r0, const uchar* r1, float beta, int n);
+    void horizontal_pass(float* const out[3], int x0);
+
+    int network_width_;
+    int network_height_;
+    bool letterbox_;
+    int src_channel_[3];
+    float scale_;
+    float pad_value_;
+
+    cv::Size src_size_;
+    cv::Rect roi_;
+    std::vector<int> xofs0_, xofs1_;    // Source element offsets of the left/right taps
+    std::vector<float> alpha_;
+    std::vector<int> yofs0_, yofs1_;    // Source rows of the top/bottom taps
+    std::vector<float> beta_;
+    std::vector<float> row_;            // Vertically interpolated source row, interleaved
+    cv::Mat converted_;
+};
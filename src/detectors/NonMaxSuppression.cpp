@@ -0,0 +1,325 @@
+#include "NonMaxSuppression.hpp"
+#include <cstring>
+#include <numeric>
+#if defined(__AVX2__) || defined(__SSE4_1__)
+#include <immintrin.h>
+#endif
+
+namespace
+{
+    // Suppression test without the division: iou > threshold <=> inter > threshold * union
+    inline bool overlaps(float ax1, float ay1, float ax2, float ay2, float a_area,
+        float bx1, float by1, float bx2, float by2, float b_area, float iou_threshold)
+    {
+        const float w = std::max(0.f, std::min(ax2, bx2) - std::max(ax1, bx1));
+        const float h = std::max(0.f, std::min(ay2, by2) - std::max(ay1, by1));
+        const float inter = w * h;
+        return inter > iou_threshold * (a_area + b_area - inter);
+    }
+
+    constexpr int max_grid_cells_per_axis = 256;
+}
+
+
+NonMaxSuppression::NonMaxSuppression(size_t top_k, size_t grid_min_candidates, size_t max_cells_per_box) :
+    top_k_{top_k},
+    grid_min_candidates_{grid_min_candidates},
+    max_cells_per_box_{std::max<size_t>(max_cells_per_box, 1)}
+{
+}
+
+
+void NonMaxSuppression::reserve(size_t candidates)
+{
+    const size_t n = top_k_ > 0 ? std::min(candidates, top_k_) : candidates;
+    sort_keys_.reserve(candidates);
+    order_.reserve(n);
+    x1_.reserve(n);
+    y1_.reserve(n);
+    x2_.reserve(n);
+    y2_.reserve(n);
+    area_.reserve(n);
+    class_ids_.reserve(n);
+    suppressed_.reserve(n);
+    keep_.reserve(n);
+    if (n >= grid_min_candidates_)
+    {
+        cell_start_.reserve(static_cast<size_t>(max_grid_cells_per_axis) * max_grid_cells_per_axis + 1);
+        cell_items_.reserve(n * max_cells_per_box_);
+        large_items_.reserve(n);
+    }
+}
+
+
+void NonMaxSuppression::sort_candidates(const BoxCandidates& candidates)
+{
+    // Score and index packed in one integer key: ascending keys give decreasing scores, ties keep
+    // the input order as the stable sort in cv::dnn::NMSBoxes, and sorting plain integers is cheap
+    const size_t count = candidates.size();
+    sort_keys_.resize(count);
+    for (size_t i = 0; i < count; ++i)
+    {
+        uint32_t bits;
+        std::memcpy(&bits, &candidates.scores[i], sizeof(bits));
+        const uint32_t ascending = (bits & 0x80000000u) ? ~bits : (bits | 0x80000000u);
+        sort_keys_[i] = (static_cast<uint64_t>(~ascending) << 32) | static_cast<uint32_t>(i);
+    }
+    if (top_k_ > 0 && count > top_k_)
+    {
+        std::nth_element(sort_keys_.begin(), sort_keys_.begin() + top_k_, sort_keys_.end());
+        sort_keys_.resize(top_k_);
+    }
+    std::sort(sort_keys_.begin(), sort_keys_.end());
+
+    order_.resize(sort_keys_.size());
+    for (size_t i = 0; i < sort_keys_.size(); ++i)
+    {
+        order_[i] = static_cast<int>(sort_keys_[i] & 0xffffffffu);
+    }
+
+    const size_t n = order_.size();
+    x1_.resize(n);
+    y1_.resize(n);
+    x2_.resize(n);
+    y2_.resize(n);
+    area_.resize(n);
+    class_ids_.resize(n);
+    for (size_t i = 0; i < n; ++i)
+    {
+        const int k = order_[i];
+        x1_[i] = candidates.x1[k];
+        y1_[i] = candidates.y1[k];
+        x2_[i] = candidates.x2[k];
+        y2_[i] = candidates.y2[k];
+        area_[i] = (x2_[i] - x1_[i]) * (y2_[i] - y1_[i]);
+        class_ids_[i] = candidates.class_ids[k];
+    }
+    suppressed_.assign(n, 0);
+}
+
+
+const std::vector<int>& NonMaxSuppression::run(const BoxCandidates& candidates, float iou_threshold, bool class_aware)
+{
+    keep_.clear();
+    if (candidates.size() == 0)
+    {
+        return keep_;
+    }
+
+    sort_candidates(candidates);
+    const size_t n = order_.size();
+    if (n >= grid_min_candidates_)
+    {
+        suppress_grid(iou_threshold, class_aware);
+        return keep_;
+    }
+
+    if (class_aware)
+    {
+        // Move every class to its own disjoint range, boxes of different classes can't intersect anymore.
+        // Areas were computed before the shift so they don't lose precision.
+        float min_coord = std::numeric_limits<float>::max();
+        float max_coord = std::numeric_limits<float>::lowest();
+        for (size_t i = 0; i < n; ++i)
+        {
+            min_coord = std::min({ min_coord, x1_[i], y1_[i] });
+            max_coord = std::max({ max_coord, x2_[i], y2_[i] });
+        }
+        const float span = max_coord - min_coord + 1.f;
+        for (size_t i = 0; i < n; ++i)
+        {
+            const float offset = class_ids_[i] * span;
+            x1_[i] += offset;
+            y1_[i] += offset;
+            x2_[i] += offset;
+            y2_[i] += offset;
+        }
+    }
+    suppress_all_pairs(iou_threshold);
+    return keep_;
+}
+
+
+void NonMaxSuppression::suppress_all_pairs(float iou_threshold)
+{
+    const int n = static_cast<int>(order_.size());
+    const float* x1 = x1_.data();
+    const float* y1 = y1_.data();
+    const float* x2 = x2_.data();
+    const float* y2 = y2_.data();
+    const float* area = area_.data();
+    int32_t* suppressed = suppressed_.data();
+
+    for (int i = 0; i < n; ++i)
+    {
+        if (suppressed[i])
+        {
+            continue;
+        }
+        keep_.push_back(order_[i]);
+
+        // Flag every lower scored box overlapping the kept one
+        int j = i + 1;
+#if defined(__AVX2__)
+        const __m256 ax1 = _mm256_set1_ps(x1[i]);
+        const __m256 ay1 = _mm256_set1_ps(y1[i]);
+        const __m256 ax2 = _mm256_set1_ps(x2[i]);
+        const __m256 ay2 = _mm256_set1_ps(y2[i]);
+        const __m256 a_area = _mm256_set1_ps(area[i]);
+        const __m256 threshold = _mm256_set1_ps(iou_threshold);
+        const __m256 zero = _mm256_setzero_ps();
+        for (; j + 8 <= n; j += 8)
+        {
+            const __m256 w = _mm256_max_ps(zero, _mm256_sub_ps(_mm256_min_ps(ax2, _mm256_loadu_ps(x2 + j)), _mm256_max_ps(ax1, _mm256_loadu_ps(x1 + j))));
+            const __m256 h = _mm256_max_ps(zero, _mm256_sub_ps(_mm256_min_ps(ay2, _mm256_loadu_ps(y2 + j)), _mm256_max_ps(ay1, _mm256_loadu_ps(y1 + j))));
+            const __m256 inter = _mm256_mul_ps(w, h);
+            const __m256 uni = _mm256_sub_ps(_mm256_add_ps(a_area, _mm256_loadu_ps(area + j)), inter);
+            const __m256 hit = _mm256_cmp_ps(inter, _mm256_mul_ps(threshold, uni), _CMP_GT_OQ);
+            __m256i* flags = reinterpret_cast<__m256i*>(suppressed + j);
+            _mm256_storeu_si256(flags, _mm256_or_si256(_mm256_loadu_si256(flags), _mm256_castps_si256(hit)));
+        }
+#elif defined(__SSE4_1__)
+        const __m128 ax1 = _mm_set1_ps(x1[i]);
+        const __m128 ay1 = _mm_set1_ps(y1[i]);
+        const __m128 ax2 = _mm_set1_ps(x2[i]);
+        const __m128 ay2 = _mm_set1_ps(y2[i]);
+        const __m128 a_area = _mm_set1_ps(area[i]);
+        const __m128 threshold = _mm_set1_ps(iou_threshold);
+        const __m128 zero = _mm_setzero_ps();
+        for (; j + 4 <= n; j += 4)
+        {
+            const __m128 w = _mm_max_ps(zero, _mm_sub_ps(_mm_min_ps(ax2, _mm_loadu_ps(x2 + j)), _mm_max_ps(ax1, _mm_loadu_ps(x1 + j))));
+            const __m128 h = _mm_max_ps(zero, _mm_sub_ps(_mm_min_ps(ay2, _mm_loadu_ps(y2 + j)), _mm_max_ps(ay1, _mm_loadu_ps(y1 + j))));
+            const __m128 inter = _mm_mul_ps(w, h);
+            const __m128 uni = _mm_sub_ps(_mm_add_ps(a_area, _mm_loadu_ps(area + j)), inter);
+            const __m128 hit = _mm_cmpgt_ps(inter, _mm_mul_ps(threshold, uni));
+            __m128i* flags = reinterpret_cast<__m128i*>(suppressed + j);
+            _mm_storeu_si128(flags, _mm_or_si128(_mm_loadu_si128(flags), _mm_castps_si128(hit)));
+        }
+#endif
+        for (; j < n; ++j)
+        {
+            if (overlaps(x1[i], y1[i], x2[i], y2[i], area[i], x1[j], y1[j], x2[j], y2[j], area[j], iou_threshold))
+            {
+                suppressed[j] = -1;
+            }
+        }
+    }
+}
+
+
+void NonMaxSuppression::suppress_grid(float iou_threshold, bool class_aware)
+{
+    const int n = static_cast<int>(order_.size());
+
+    // Cell side about the mean box side, so a box spans few cells
+    float min_x = std::numeric_limits<float>::max(), min_y = min_x;
+    float max_x = std::numeric_limits<float>::lowest(), max_y = max_x;
+    double mean_side = 0.0;
+    for (int i = 0; i < n; ++i)
+    {
+        min_x = std::min(min_x, x1_[i]);
+        min_y = std::min(min_y, y1_[i]);
+        max_x = std::max(max_x, x2_[i]);
+        max_y = std::max(max_y, y2_[i]);
+        mean_side += std::max(x2_[i] - x1_[i], y2_[i] - y1_[i]);
+    }
+    const float cell_side = std::max(1.f, static_cast<float>(mean_side / n));
+    const int grid_w = std::clamp(static_cast<int>((max_x - min_x) / cell_side) + 1, 1, max_grid_cells_per_axis);
+    const int grid_h = std::clamp(static_cast<int>((max_y - min_y) / cell_side) + 1, 1, max_grid_cells_per_axis);
+    const float inv_w = grid_w / std::max(max_x - min_x, 1.f);
+    const float inv_h = grid_h / std::max(max_y - min_y, 1.f);
+
+    const auto cell_range = [&](int i, int& cx0, int& cy0, int& cx1, int& cy1) {
+        cx0 = std::clamp(static_cast<int>((x1_[i] - min_x) * inv_w), 0, grid_w - 1);
+        cx1 = std::clamp(static_cast<int>((x2_[i] - min_x) * inv_w), 0, grid_w - 1);
+        cy0 = std::clamp(static_cast<int>((y1_[i] - min_y) * inv_h), 0, grid_h - 1);
+        cy1 = std::clamp(static_cast<int>((y2_[i] - min_y) * inv_h), 0, grid_h - 1);
+    };
+
+    // Bucket every box in all the cells it touches (compressed rows, items ascending by score rank).
+    // A box spanning a large part of the grid would fill that many cells, it goes to large_items_.
+    const auto is_large = [this](int cx0, int cy0, int cx1, int cy1) {
+        return static_cast<size_t>(cx1 - cx0 + 1) * static_cast<size_t>(cy1 - cy0 + 1) > max_cells_per_box_;
+    };
+    cell_start_.assign(static_cast<size_t>(grid_w) * grid_h + 1, 0);
+    large_items_.clear();
+    int cx0, cy0, cx1, cy1;
+    for (int i = 0; i < n; ++i)
+    {
+        cell_range(i, cx0, cy0, cx1, cy1);
+        if (is_large(cx0, cy0, cx1, cy1))
+        {
+            large_items_.push_back(i);
+            continue;
+        }
+        for (int cy = cy0; cy <= cy1; ++cy)
+            for (int cx = cx0; cx <= cx1; ++cx)
+                ++cell_start_[cy * grid_w + cx + 1];
+    }
+    std::partial_sum(cell_start_.begin(), cell_start_.end(), cell_start_.begin());
+    cell_items_.resize(cell_start_.back());
+    for (int i = 0; i < n; ++i)
+    {
+        cell_range(i, cx0, cy0, cx1, cy1);
+        if (is_large(cx0, cy0, cx1, cy1))
+        {
+            continue;
+        }
+        for (int cy = cy0; cy <= cy1; ++cy)
+            for (int cx = cx0; cx <= cx1; ++cx)
+                cell_items_[cell_start_[cy * grid_w + cx]++] = i;
+    }
+    // Filling advanced every start to the next cell's one, shift back
+    std::copy_backward(cell_start_.begin(), cell_start_.end() - 1, cell_start_.end());
+    cell_start_[0] = 0;
+
+    const auto suppress = [&](int i, const int* begin, const int* end) {
+        for (const int* it = std::upper_bound(begin, end, i); it != end; ++it)
+        {
+            const int j = *it;
+            if (suppressed_[j] || (class_aware && class_ids_[j] != class_ids_[i]))
+            {
+                continue;
+            }
+            if (overlaps(x1_[i], y1_[i], x2_[i], y2_[i], area_[i], x1_[j], y1_[j], x2_[j], y2_[j], area_[j], iou_threshold))
+            {
+                suppressed_[j] = -1;
+            }
+        }
+    };
+
+    // Same greedy order as the all pairs scan, only neighbours sharing a cell and the large boxes are
+    // compared. A large kept box is compared with every lower scored box.
+    for (int i = 0; i < n; ++i)
+    {
+        if (suppressed_[i])
+        {
+            continue;
+        }
+        keep_.push_back(order_[i]);
+
+        cell_range(i, cx0, cy0, cx1, cy1);
+        if (is_large(cx0, cy0, cx1, cy1))
+        {
+            for (int j = i + 1; j < n; ++j)
+            {
+                if (!suppressed_[j] && (!class_aware || class_ids_[j] == class_ids_[i]) &&
+                    overlaps(x1_[i], y1_[i], x2_[i], y2_[i], area_[i], x1_[j], y1_[j], x2_[j], y2_[j], area_[j], iou_threshold))
+                {
+                    suppressed_[j] = -1;
+                }
+            }
+            continue;
+        }
+        for (int cy = cy0; cy <= cy1; ++cy)
+        {
+            for (int cx = cx0; cx <= cx1; ++cx)
+            {
+                const int cell = cy * grid_w + cx;
+                suppress(i, cell_items_.data() + cell_start_[cell], cell_items_.data() + cell_start_[cell + 1]);
+            }
+        }
+        suppress(i, large_items_.data(), large_items_.data() + large_items_.size());
+    }
+}
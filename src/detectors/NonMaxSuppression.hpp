@@ -0,0 +1,89 @@
+#pragma once
+#include "common.hpp"
+
+// Detection candidates in structure of arrays layout, boxes as float corners
+struct BoxCandidates
+{
+    std::vector<float> x1, y1, x2, y2;
+    std::vector<float> scores;
+    std::vector<int> class_ids;
+
+    size_t size() const { return scores.size(); }
+
+    void reserve(size_t n)
+    {
+        x1.reserve(n);
+        y1.reserve(n);
+        x2.reserve(n);
+        y2.reserve(n);
+        scores.reserve(n);
+        class_ids.reserve(n);
+    }
+
+    void clear()
+    {
+        x1.clear();
+        y1.clear();
+        x2.clear();
+        y2.clear();
+        scores.clear();
+        class_ids.clear();
+    }
+
+    void add(float left, float top, float right, float bottom, float score, int class_id)
+    {
+        x1.push_back(left);
+        y1.push_back(top);
+        x2.push_back(right);
+        y2.push_back(bottom);
+        scores.push_back(score);
+        class_ids.push_back(class_id);
+    }
+
+    void add(const cv::Rect& box, float score, int class_id)
+    {
+        add(box.x, box.y, box.x + box.width, box.y + box.height, score, class_id);
+    }
+};
+
+// Greedy non maximum suppression on float boxes, same semantics as cv::dnn::NMSBoxes
+// (visit by decreasing score, drop a box whose IoU with an already kept one is above the threshold).
+// Class aware mode shifts each class to its own coordinate range so one pass never mixes classes.
+// Candidates beyond top_k (by score) are discarded upfront, and large candidate sets switch from the
+// vectorized all pairs scan to a uniform grid that only compares spatial neighbours; boxes covering
+// more than max_cells_per_box cells stay out of the grid and are compared with every box instead.
+class NonMaxSuppression
+{
+public:
+    // top_k 0 keeps every candidate
+    explicit NonMaxSuppression(size_t top_k = 1000, size_t grid_min_candidates = 2048, size_t max_cells_per_box = 16);
+
+    void set_top_k(size_t top_k) { top_k_ = top_k; }
+    size_t top_k() const { return top_k_; }
+
+    // Sizes the scratch for up to candidates boxes per call, runs within that count don't allocate
+    void reserve(size_t candidates);
+
+    // Indices into candidates of the kept boxes, by decreasing score. Valid until the next call.
+    const std::vector<int>& run(const BoxCandidates& candidates, float iou_threshold, bool class_aware);
+
+private:
+    void sort_candidates(const BoxCandidates& candidates);
+    void suppress_all_pairs(float iou_threshold);
+    void suppress_grid(float iou_threshold, bool class_aware);
+
+    size_t top_k_;
+    size_t grid_min_candidates_;
+    size_t max_cells_per_box_;
+
+    // Scratch, reused between calls
+    std::vector<uint64_t> sort_keys_;
+    std::vector<int> order_;                    // Candidate indices by decreasing score
+    std::vector<float> x1_, y1_, x2_, y2_, area_; // Sorted (and class shifted) boxes
+    std::vector<int> class_ids_;
+    std::vector<int32_t> suppressed_;           // 0 or -1 per sorted box
+    std::vector<int> cell_start_;
+    std::vector<int> cell_items_;
+    std::vector<int> large_items_;              // Boxes left out of the grid, ascending by score rank
+    std::vector<int> keep_;
+};
@@ -6,13 +6,14 @@ RtDetr::RtDetr(
     size_t network_height) : 
     Detector{confidenceThreshold,
             network_width,
-            network_height}
+            network_height},
+    preprocessor_{static_cast<int>(network_width), static_cast<int>(network_height), false, true}
 {
 
 }
 
 
-std::vector<Detection> RtDetr::postprocess(const std::vector<std::vector<std::any>>& outputs, const std::vector<std::vector<int64_t>>& shapes, const cv::Size& frame_size) {
+void RtDetr::postprocess(const std::vector<TensorView>& outputs, const cv::Size& frame_size, std::vector<Detection>& detections) {
 
     size_t labels_idx = 0;
     size_t boxes_idx = 1;
@@ -20,104 +21,64 @@ std::vector<Detection> RtDetr::postprocess(const std::vector<std::vector<std::an
 
     // Output order of this model somewhat changes when it is export to TensorRT.
     // In TensorRT model i'm expecting bounding box output at index 2
-    if(shapes[2][2] == 4)
+    if(outputs[2].dim(2) == 4)
     {
         labels_idx = 1;
         boxes_idx = 2;
         scores_idx = 0;
     }
 
-    const std::any* scores_ptr = outputs[scores_idx].data();
-    const std::vector<int64_t>& shape_scores = shapes[scores_idx];
+    const TensorView& scores = outputs[scores_idx];
+    const TensorView& boxes_tensor = outputs[boxes_idx];
+    const TensorView& labels = outputs[labels_idx];
 
-    const std::any* boxes_ptr = outputs[boxes_idx].data();
-    const std::vector<int64_t>& shape_boxes = shapes[boxes_idx];
-
-    const std::any* labels_ptr = outputs[labels_idx].data();
-    const std::vector<int64_t>& shape_labels = shapes[labels_idx];
-
-
-    std::vector<int> classIds;
-    std::vector<float> confidences;
-    std::vector<cv::Rect> boxes;
-
-    int rows = shape_labels[1]; // 300
+    int rows = labels.dim(1); // 300
+    reserve_candidates(rows, detections);
+    boxes_.clear();
 
     // Type checking
-    const std::type_info& label_type = labels_ptr[0].type();
-
-    if(scores_ptr[0].type() != typeid(float))
+    if(scores.type() != TensorType::Float32)
     {
         std::cerr << "Expecting scores tensor as float type" << std::endl;
         std::exit(1);
     }
 
-    if(scores_ptr[0].type() != typeid(float))
+    if(boxes_tensor.type() != TensorType::Float32)
     {
         std::cerr << "Expecting boxes tensor as float type" << std::endl;
         std::exit(1);
     }
 
+    // in tensorrt type label tensor is int32, with onnx is int64
+    if(labels.type() == TensorType::Float32)
+    {
+        std::cerr << "Unexpected label type" << std::endl;
+        std::exit(1);
+    }
+
+    const float* scores_ptr = scores.data<float>();
+    const float* boxes_ptr = boxes_tensor.data<float>();
+    const float r_w = (float)frame_size.width / network_width_;
+    const float r_h = (float)frame_size.height / network_height_;
 
     // Iterate through detections.
     for (int i = 0; i < rows; ++i) {
-        float score = std::any_cast<float>(scores_ptr[i]);
+        float score = scores_ptr[i];
         if (score >= confidenceThreshold_) {
-
-            // in tensorrt type label tensor is int32
-            if(label_type == typeid(int32_t))
-            {
-                auto label = std::any_cast<int32_t>(labels_ptr[i]);
-                classIds.push_back(label);
-            }
-            //with  onnx is int64
-            else if(label_type == typeid(int64_t))
-            {
-                auto label = std::any_cast<int64_t>(labels_ptr[i]);
-                classIds.push_back(label);
-
-            }
-            else
-            {
-                std::cerr << "Unexpected label type" << std::endl;
-                std::exit(1);
-            }
-                  
-            confidences.push_back(score);
-            float r_w = (float)frame_size.width / network_width_;
-            float r_h = (float)frame_size.height / network_height_;
-            float x1 =  std::any_cast<float>(boxes_ptr[i*4]);
-            float y1 =  std::any_cast<float>(boxes_ptr[i*4 + 1]);
-            float x2 =  std::any_cast<float>(boxes_ptr[i*4 + 2]);
-            float y2 =  std::any_cast<float>(boxes_ptr[i*4 + 3]);
-            x2 *= r_w;
-            y2 *= r_h;
-            x1 *= r_w;
-            y1 *= r_h;
-            boxes.push_back(cv::Rect(cv::Point(x1, y1), cv::Point(x2, y2)));
+            float x1 = boxes_ptr[i*4] * r_w;
+            float y1 = boxes_ptr[i*4 + 1] * r_h;
+            float x2 = boxes_ptr[i*4 + 2] * r_w;
+            float y2 = boxes_ptr[i*4 + 3] * r_h;
+            boxes_.add(cv::Rect(cv::Point(x1, y1), cv::Point(x2, y2)), score, labels.value<int>(i));
         }
     }
 
     // Perform Non Maximum Suppression and draw predictions.
-    std::vector<int> indices;
-    cv::dnn::NMSBoxes(boxes, confidences, confidenceThreshold_, nms_threshold_, indices);
-    std::vector<Detection> detections;
-    for (int i = 0; i < indices.size(); i++) 
-    {
-        Detection det;
-        int idx = indices[i];
-        det.label = classIds[idx];
-        det.bbox = boxes[idx];
-        det.score = confidences[idx];
-        detections.emplace_back(det);
-    }
-    return detections; 
+    apply_nms(boxes_, detections);
 
 }
 
-cv::Mat RtDetr::preprocess_image(const cv::Mat& image)
+void RtDetr::preprocess_image(const cv::Mat& image, cv::Mat& blob)
 {
-    cv::Mat output_image;   
-    cv::dnn::blobFromImage(image, output_image, 1.f / 255.f, cv::Size(network_height_, network_width_), cv::Scalar(), true, false);
-    return output_image;
+    preprocessor_.run(image, blob);
 }
\ No newline at end of file
@@ -1,5 +1,6 @@
 #pragma once
 #include "Detector.hpp"
+#include "FusedPreprocessor.hpp"
 class RtDetr : public Detector
 {
 
@@ -10,6 +11,10 @@ public:
         size_t network_height = 640);
 
 
-    cv::Mat preprocess_image(const cv::Mat& image) override;
-    std::vector<Detection> postprocess(const std::vector<std::vector<std::any>>& outputs, const std::vector<std::vector<int64_t>>& shapes, const cv::Size& frame_size) override;    
+    void preprocess_image(const cv::Mat& image, cv::Mat& blob) override;
+    using Detector::postprocess;
+    void postprocess(const std::vector<TensorView>& outputs, const cv::Size& frame_size, std::vector<Detection>& detections) override;
+
+private:
+    FusedPreprocessor preprocessor_;
 };
\ No newline at end of file
@@ -1,5 +1,6 @@
 #pragma once
 #include "Detector.hpp"
+#include "FusedPreprocessor.hpp"
 
 class YoloNas : public Detector{
 
@@ -9,6 +10,10 @@ public:
         size_t network_width = 640,
         size_t network_height = 640);    
         
-    std::vector<Detection> postprocess(const std::vector<std::vector<std::any>>& outputs, const std::vector<std::vector<int64_t>>& shapes, const cv::Size& frame_size) override;
-    cv::Mat preprocess_image(const cv::Mat& image) override; 
+    using Detector::postprocess;
+    void postprocess(const std::vector<TensorView>& outputs, const cv::Size& frame_size, std::vector<Detection>& detections) override;
+    void preprocess_image(const cv::Mat& image, cv::Mat& blob) override;
+
+private:
+    FusedPreprocessor preprocessor_;
 };   
\ No newline at end of file
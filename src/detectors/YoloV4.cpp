@@ -1,4 +1,5 @@
 #include "YoloV4.hpp"
+#include "DecodeUtils.hpp"
 
     YoloV4::YoloV4(
         float confidenceThreshold,
@@ -9,25 +10,32 @@
         Detector{
         confidenceThreshold,
         network_width,
-        network_height}
+        network_height},
+        preprocessor_{static_cast<int>(network_width), static_cast<int>(network_height), false, true}
 	{
 
 	}
 
 
-cv::Mat YoloV4::preprocess_image(const cv::Mat& image)
+void YoloV4::preprocess_image(const cv::Mat& image, cv::Mat& blob)
 {
-    cv::Mat blob;
-    cv::dnn::blobFromImage(image, blob, 1 / 255.F, cv::Size(network_width_, network_height_), cv::Scalar(), true, false, CV_32F);   
-    return blob;    
+    preprocessor_.run(image, blob);
 }
 
 
-std::vector<Detection> YoloV4::postprocess(const std::vector<std::vector<std::any>>& outputs, const std::vector<std::vector<int64_t>>& shapes, const cv::Size& frame_size)
+void YoloV4::postprocess(const std::vector<TensorView>& outputs, const cv::Size& frame_size, std::vector<Detection>& detections)
 {
-    std::vector<int> classIds;
-    std::vector<float> confidences;
-    std::vector<cv::Rect> boxes;
+    // Every row of every region output may be a candidate
+    size_t max_candidates = 0;
+    size_t max_rows = 0;
+    for (const TensorView& output : outputs)
+    {
+        max_candidates += output.dim(0);
+        max_rows = std::max<size_t>(max_rows, output.dim(0));
+    }
+    reserve_candidates(max_candidates, detections);
+    candidates_.reserve(max_rows);
+    boxes_.clear();
 
     const auto cols = frame_size.width;
     const auto rows = frame_size.height;
@@ -37,62 +45,31 @@ std::vector<Detection> YoloV4::postprocess(const std::vector<std::vector<std::an
         // Network produces output blob with a shape NxC where N is a number of
         // detected objects and C is a number of classes + 4 where the first 4
         // numbers are [center_x, center_y, width, height]
-        const std::any* output = outputs[i].data();
-        for (int j = 0; j < shapes[i][0]; ++j, output += shapes[i][1])
+        const float* data = outputs[i].data<float>();
+        const std::vector<int64_t>& shape = outputs[i].shape();
+
+        // Region layer class scores are already scaled by the objectness (index 4), so a row whose
+        // objectness doesn't pass the threshold can't either: skip those before the class argmax
+        select_strided_above_threshold(data + 4, shape[1], shape[0], confidenceThreshold_, candidates_);
+        for (const int j : candidates_)
         {
-            auto maxSPtr = std::max_element(output + 5, output + shapes[i][1], [](const std::any& a, const std::any& b) {
-                return std::any_cast<float>(a) < std::any_cast<float>(b);
-            });
-            float score = std::any_cast<float>(*maxSPtr);
+            const float* output = data + static_cast<size_t>(j) * shape[1];
+            const float* maxSPtr = std::max_element(output + 5, output + shape[1]);
+            float score = *maxSPtr;
             if (score > confidenceThreshold_)
             {
-                int centerX = std::any_cast<float>(output[0]) * cols;
-                int centerY = std::any_cast<float>(output[1]) * rows;
-                int width = std::any_cast<float>(output[2]) * cols;
-                int height = std::any_cast<float>(output[3]) * rows;
+                int centerX = output[0] * cols;
+                int centerY = output[1] * rows;
+                int width = output[2] * cols;
+                int height = output[3] * rows;
                 int left = centerX - width / 2;
                 int top = centerY - height / 2;
                 int label = maxSPtr - (output + 5);
-                classIds.push_back(label);
-                confidences.push_back(score);
-                boxes.push_back(cv::Rect(left, top, width, height));
+                boxes_.add(cv::Rect(left, top, width, height), score, label);
             }
         }
     }
 
-    std::vector<Detection> detections;
-    std::map<int, std::vector<size_t> > class2indices;
-    for (size_t i = 0; i < classIds.size(); i++)
-    {
-        if (confidences[i] >= confidenceThreshold_)
-        {
-            class2indices[classIds[i]].push_back(i);
-        }
-    }
-
-    for (std::map<int, std::vector<size_t> >::iterator it = class2indices.begin(); it != class2indices.end(); ++it)
-    {
-        std::vector<cv::Rect> localBoxes;
-        std::vector<float> localConfidences;
-        std::vector<size_t> classIndices = it->second;
-        for (size_t i = 0; i < classIndices.size(); i++)
-        {
-            localBoxes.push_back(boxes[classIndices[i]]);
-            localConfidences.push_back(confidences[classIndices[i]]);
-        }
-        std::vector<int> nmsIndices;
-        cv::dnn::NMSBoxes(localBoxes, localConfidences, confidenceThreshold_, nms_threshold_, nmsIndices);
-        for (size_t i = 0; i < nmsIndices.size(); i++)
-        {
-            Detection d;
-            size_t idx = nmsIndices[i];
-            d.bbox = localBoxes[idx];
-            d.score = localConfidences[idx];
-            d.label = it->first;
-            detections.emplace_back(d);
-
-        }
-    }
-
-    return detections;
+    // Per class suppression in a single pass
+    apply_nms(boxes_, detections, true);
 }
\ No newline at end of file
@@ -1,5 +1,6 @@
 #pragma once
 #include "Detector.hpp"
+#include "FusedPreprocessor.hpp"
 
 class YoloV4 : public  Detector{
 
@@ -8,6 +9,11 @@ public:
         float confidenceThreshold = 0.25,
         size_t network_width = 416,
         size_t network_height = 416); 
-    std::vector<Detection> postprocess(const std::vector<std::vector<std::any>>& outputs, const std::vector<std::vector<int64_t>>& shapes, const cv::Size& frame_size) override;
-    cv::Mat preprocess_image(const cv::Mat& image) override; 
+    using Detector::postprocess;
+    void postprocess(const std::vector<TensorView>& outputs, const cv::Size& frame_size, std::vector<Detection>& detections) override;
+    void preprocess_image(const cv::Mat& image, cv::Mat& blob) override;
+
+private:
+    FusedPreprocessor preprocessor_;
+    std::vector<int> candidates_;   // Decode scratch
 };
\ No newline at end of file
@@ -0,0 +1,157 @@
+#include "EnginePool.hpp"
+
+EnginePool::EnginePool(std::vector<std::unique_ptr<InferenceInterface>> replicas) :
+    InferenceInterface{"", ""},
+    start_{std::chrono::steady_clock::now()}
+{
+    if (replicas.empty())
+    {
+        logger_->error("Engine pool needs at least one replica");
+        std::exit(1);
+    }
+
+    // One request running and one queued per replica keeps every replica busy
+    for (auto& engine : replicas)
+    {
+        auto replica = std::make_unique<Replica>();
+        replica->engine = std::move(engine);
+        replica->worker = std::thread(&EnginePool::replica_loop, this, std::ref(*replica));
+        replicas_.push_back(std::move(replica));
+    }
+    max_outstanding_ = 2 * replicas_.size();
+}
+
+
+EnginePool::~EnginePool()
+{
+    shutdown_async();
+    for (auto& replica : replicas_)
+    {
+        {
+            std::lock_guard<std::mutex> lock(replica->mutex);
+            replica->stop = true;
+        }
+        replica->wakeup.notify_one();
+        replica->worker.join();
+    }
+    log_utilization();
+}
+
+
+std::vector<TensorView> EnginePool::get_infer_results(const cv::Mat& input_blob)
+{
+    return infer_async(input_blob).get();
+}
+
+
+size_t EnginePool::max_batch_size() const
+{
+    size_t max_batch = std::numeric_limits<size_t>::max();
+    for (const auto& replica : replicas_)
+    {
+        max_batch = std::min(max_batch, replica->engine->max_batch_size());
+    }
+    return max_batch;
+}
+
+
+void EnginePool::submit_async(const cv::Mat& input_blob, AsyncCallback on_complete)
+{
+    Replica* target = replicas_.front().get();
+    for (const auto& replica : replicas_)
+    {
+        if (replica->load.load(std::memory_order_relaxed) < target->load.load(std::memory_order_relaxed))
+        {
+            target = replica.get();
+        }
+    }
+    target->load.fetch_add(1, std::memory_order_relaxed);
+
+    Request request;
+    {
+        std::lock_guard<std::mutex> lock(target->mutex);
+        if (!target->spare_blobs.empty())
+        {
+            request.input_blob = std::move(target->spare_blobs.back());
+            target->spare_blobs.pop_back();
+        }
+    }
+    input_blob.copyTo(request.input_blob);
+    request.on_complete = std::move(on_complete);
+    {
+        std::lock_guard<std::mutex> lock(target->mutex);
+        target->queue.push_back(std::move(request));
+    }
+    target->wakeup.notify_one();
+}
+
+
+void EnginePool::replica_loop(Replica& replica)
+{
+    for (;;)
+    {
+        Request request;
+        {
+            std::unique_lock<std::mutex> lock(replica.mutex);
+            replica.wakeup.wait(lock, [&replica] { return replica.stop || !replica.queue.empty(); });
+            if (replica.queue.empty())
+            {
+                return;
+            }
+            request = std::move(replica.queue.front());
+            replica.queue.pop_front();
+        }
+
+        const auto start = std::chrono::steady_clock::now();
+        std::vector<TensorView> outputs;
+        std::exception_ptr error;
+        try
+        {
+            outputs = replica.engine->get_infer_results(request.input_blob);
+            if (replica.engine->output_buffers_reused())
+            {
+                for (TensorView& output : outputs)
+                {
+                    output = output.clone();
+                }
+            }
+        }
+        catch (...)
+        {
+            error = std::current_exception();
+        }
+        const auto busy = std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now() - start).count();
+        replica.busy_ns.fetch_add(busy, std::memory_order_relaxed);
+        replica.requests.fetch_add(1, std::memory_order_relaxed);
+        {
+            std::lock_guard<std::mutex> lock(replica.mutex);
+            replica.spare_blobs.push_back(std::move(request.input_blob));
+        }
+        replica.load.fetch_sub(1, std::memory_order_relaxed);
+        request.on_complete(std::move(outputs), error);
+    }
+}
+
+
+std::vector<EnginePool::ReplicaStats> EnginePool::stats() const
+{
+    const double elapsed = std::chrono::duration<double>(std::chrono::steady_clock::now() - start_).count();
+    std::vector<ReplicaStats> stats;
+    for (const auto& replica : replicas_)
+    {
+        const double busy = replica->busy_ns.load(std::memory_order_relaxed) * 1e-9;
+        stats.push_back({ replica->requests.load(std::memory_order_relaxed), busy, elapsed > 0 ? busy / elapsed : 0.0 });
+    }
+    return stats;
+}
+
+
+void EnginePool::log_utilization() const
+{
+    const std::vector<ReplicaStats> replica_stats = stats();
+    for (size_t i = 0; i < replica_stats.size(); ++i)
+    {
+        logger_->info("Replica {}: {} requests, busy {:.2f} s, utilization {:.1f}%", i,
+            replica_stats[i].requests, replica_stats[i].busy_seconds, 100.0 * replica_stats[i].utilization);
+    }
+}
@@ -0,0 +1,57 @@
+#pragma once
+#include "InferenceInterface.hpp"
+#include <atomic>
+
+// K replicas of an engine behind one InferenceInterface. Every replica runs on its own worker thread
+// (with whatever thread budget it was created with) and each request goes to the least loaded one,
+// so several small sessions can serve concurrent callers instead of one large intra op thread pool.
+// Outputs are copied out of replicas reusing their buffers, they stay valid across calls.
+class EnginePool : public InferenceInterface
+{
+public:
+    struct ReplicaStats
+    {
+        uint64_t requests;
+        double busy_seconds;
+        double utilization;     // Busy time over the pool lifetime
+    };
+
+    explicit EnginePool(std::vector<std::unique_ptr<InferenceInterface>> replicas);
+    ~EnginePool() override;
+
+    std::vector<TensorView> get_infer_results(const cv::Mat& input_blob) override;
+    size_t max_batch_size() const override;
+
+    size_t size() const { return replicas_.size(); }
+    std::vector<ReplicaStats> stats() const;
+    void log_utilization() const;
+
+protected:
+    void submit_async(const cv::Mat& input_blob, AsyncCallback on_complete) override;
+
+private:
+    struct Request
+    {
+        cv::Mat input_blob;
+        AsyncCallback on_complete;
+    };
+
+    struct Replica
+    {
+        std::unique_ptr<InferenceInterface> engine;
+        std::mutex mutex;
+        std::condition_variable wakeup;
+        std::deque<Request> queue;
+        std::vector<cv::Mat> spare_blobs;
+        std::thread worker;
+        bool stop{false};
+        std::atomic<size_t> load{0};            // Queued plus running requests
+        std::atomic<uint64_t> requests{0};
+        std::atomic<int64_t> busy_ns{0};
+    };
+
+    void replica_loop(Replica& replica);
+
+    std::vector<std::unique_ptr<Replica>> replicas_;
+    std::chrono::steady_clock::time_point start_;
+};
@@ -1,25 +1,257 @@
 #include "InferenceInterface.hpp"
+#include <cstring>
 
 std::shared_ptr<spdlog::logger> InferenceInterface::logger_;
 
 
-std::vector<float> InferenceInterface::blob2vec(const cv::Mat& input_blob)
+InferenceInterface::~InferenceInterface()
 {
+    shutdown_async();
+}
 
-    const auto channels = input_blob.size[1];
-    const auto network_width = input_blob.size[2];
-    const auto network_height = input_blob.size[3];
-    size_t img_byte_size = network_width * network_height * channels * sizeof(float);  // Allocate a buffer to hold all image elements.
-    std::vector<float> input_data = std::vector<float>(network_width * network_height * channels);
-    std::memcpy(input_data.data(), input_blob.data, img_byte_size);
 
-    std::vector<cv::Mat> chw;
-    for (size_t i = 0; i < channels; ++i)
+void InferenceInterface::shutdown_async()
+{
+    wait_async();
+    if (worker_.joinable())
+    {
+        {
+            std::lock_guard<std::mutex> lock(worker_mutex_);
+            stop_worker_ = true;
+        }
+        worker_wakeup_.notify_one();
+        worker_.join();
+    }
+}
+
+
+bool InferenceInterface::stage_input(const cv::Mat& input_blob)
+{
+    // Same size and type copies reuse the arena, so this only allocates on a shape change
+    if (input_blob.data != input_blob_.data)
+    {
+        input_blob.copyTo(input_blob_);
+    }
+
+    // A reallocation can land on the same address, so compare the shape as well
+    const bool same_shape = input_blob_.dims == static_cast<int>(bound_input_shape_.size()) &&
+        std::equal(bound_input_shape_.begin(), bound_input_shape_.end(), input_blob_.size.p);
+    if (input_blob_.data == bound_input_data_ && same_shape)
+    {
+        return false;
+    }
+
+    bound_input_data_ = input_blob_.data;
+    bound_input_shape_.assign(input_blob_.size.p, input_blob_.size.p + input_blob_.dims);
+    return true;
+}
+
+
+std::vector<cv::Mat> InferenceInterface::get_input_batch(size_t n)
+{
+    std::vector<cv::Mat> slices;
+    if (input_blob_.empty() || n == 0)
+    {
+        return slices;
+    }
+
+    std::vector<int> dims(input_blob_.size.p, input_blob_.size.p + input_blob_.dims);
+    dims[0] = static_cast<int>(n);
+    input_blob_.create(dims, input_blob_.type());
+
+    // ROI headers share the arena reference count, a later reallocation doesn't leave them dangling
+    std::vector<cv::Range> ranges(input_blob_.dims, cv::Range::all());
+    for (size_t i = 0; i < n; ++i)
+    {
+        ranges[0] = cv::Range(static_cast<int>(i), static_cast<int>(i) + 1);
+        slices.emplace_back(input_blob_(ranges));
+    }
+    return slices;
+}
+
+
+void InferenceInterface::pack_batch(const cv::Mat* input_blobs, size_t count)
+{
+    const cv::Mat& first = input_blobs[0];
+    std::vector<int> dims(first.size.p, first.size.p + first.dims);
+    if (dims.empty() || dims[0] != 1)
+    {
+        logger_->error("Batched inputs must be 1 x C x H x W blobs");
+        std::exit(1);
+    }
+    dims[0] = static_cast<int>(count);
+    input_blob_.create(dims, first.type());
+
+    const size_t slice_size = first.total() * first.elemSize();
+    for (size_t i = 0; i < count; ++i)
+    {
+        const cv::Mat& blob = input_blobs[i];
+        if (blob.total() * blob.elemSize() != slice_size || blob.type() != first.type() || !blob.isContinuous())
+        {
+            logger_->error("Batched inputs must share shape and type");
+            std::exit(1);
+        }
+        uchar* slice = input_blob_.data + i * slice_size;
+        if (blob.data != slice)
+        {
+            std::memcpy(slice, blob.data, slice_size);
+        }
+    }
+}
+
+
+std::vector<std::vector<TensorView>> InferenceInterface::get_infer_results_batch(const std::vector<cv::Mat>& input_blobs)
+{
+    std::vector<std::vector<TensorView>> results;
+    results.reserve(input_blobs.size());
+    const size_t max_batch = std::max<size_t>(max_batch_size(), 1);
+    for (size_t first = 0; first < input_blobs.size(); first += max_batch)
     {
-        chw.emplace_back(cv::Mat(cv::Size(network_width, network_height), CV_32FC1, &(input_data[i * network_width * network_height])));
+        const size_t count = std::min(max_batch, input_blobs.size() - first);
+        pack_batch(input_blobs.data() + first, count);
+        std::vector<TensorView> outputs = get_infer_results(input_blob_);
+        if (output_buffers_reused() && first + count < input_blobs.size())
+        {
+            // The next chunk overwrites these buffers
+            for (TensorView& output : outputs)
+            {
+                output = output.clone();
+            }
+        }
+
+        // Outputs are sliced along their outer dimension, it is the batch one for most models,
+        // flattened detection lists (darknet region layers) hold count equal blocks of rows
+        for (size_t i = 0; i < count; ++i)
+        {
+            std::vector<TensorView> image_outputs;
+            image_outputs.reserve(outputs.size());
+            for (const TensorView& output : outputs)
+            {
+                const int64_t rows = output.rank() > 0 ? output.dim(0) : 0;
+                if (rows % static_cast<int64_t>(count) != 0)
+                {
+                    logger_->error("Can't split an output with {} rows into a batch of {}", rows, count);
+                    std::exit(1);
+                }
+                const int64_t rows_per_image = rows / static_cast<int64_t>(count);
+                image_outputs.emplace_back(output.slice(i * rows_per_image, rows_per_image));
+            }
+            results.emplace_back(std::move(image_outputs));
+        }
     }
-    cv::split(input_blob, chw);
+    return results;
+}
 
-    return input_data;    
-}	
 
+std::future<std::vector<TensorView>> InferenceInterface::infer_async(const cv::Mat& input_blob)
+{
+    {
+        std::unique_lock<std::mutex> lock(outstanding_mutex_);
+        outstanding_changed_.wait(lock, [this] { return outstanding_ < max_outstanding_; });
+        ++outstanding_;
+    }
+
+    auto promise = std::make_shared<std::promise<std::vector<TensorView>>>();
+    std::future<std::vector<TensorView>> result = promise->get_future();
+    const auto complete = [this, promise](std::vector<TensorView>&& outputs, std::exception_ptr error) {
+        if (error)
+        {
+            promise->set_exception(error);
+        }
+        else
+        {
+            promise->set_value(std::move(outputs));
+        }
+        {
+            std::lock_guard<std::mutex> lock(outstanding_mutex_);
+            --outstanding_;
+        }
+        outstanding_changed_.notify_all();
+    };
+    try
+    {
+        submit_async(input_blob, complete);
+    }
+    catch (...)
+    {
+        // Nothing was submitted, the callback won't run: release the slot here
+        complete({}, std::current_exception());
+    }
+    return result;
+}
+
+
+void InferenceInterface::wait_async()
+{
+    std::unique_lock<std::mutex> lock(outstanding_mutex_);
+    outstanding_changed_.wait(lock, [this] { return outstanding_ == 0; });
+}
+
+
+void InferenceInterface::submit_async(const cv::Mat& input_blob, AsyncCallback on_complete)
+{
+    PendingRequest request;
+    {
+        std::lock_guard<std::mutex> lock(worker_mutex_);
+        if (!worker_.joinable())
+        {
+            worker_ = std::thread(&InferenceInterface::async_worker, this);
+        }
+        if (!spare_blobs_.empty())
+        {
+            request.input_blob = std::move(spare_blobs_.back());
+            spare_blobs_.pop_back();
+        }
+    }
+
+    // Same shape copies reuse the spare buffer
+    input_blob.copyTo(request.input_blob);
+    request.on_complete = std::move(on_complete);
+    {
+        std::lock_guard<std::mutex> lock(worker_mutex_);
+        pending_.push_back(std::move(request));
+    }
+    worker_wakeup_.notify_one();
+}
+
+
+void InferenceInterface::async_worker()
+{
+    for (;;)
+    {
+        PendingRequest request;
+        {
+            std::unique_lock<std::mutex> lock(worker_mutex_);
+            worker_wakeup_.wait(lock, [this] { return stop_worker_ || !pending_.empty(); });
+            if (pending_.empty())
+            {
+                return;
+            }
+            request = std::move(pending_.front());
+            pending_.pop_front();
+        }
+
+        std::vector<TensorView> outputs;
+        std::exception_ptr error;
+        try
+        {
+            outputs = get_infer_results(request.input_blob);
+            if (output_buffers_reused())
+            {
+                for (TensorView& output : outputs)
+                {
+                    output = output.clone();
+                }
+            }
+        }
+        catch (...)
+        {
+            error = std::current_exception();
+        }
+        {
+            std::lock_guard<std::mutex> lock(worker_mutex_);
+            spare_blobs_.push_back(std::move(request.input_blob));
+        }
+        request.on_complete(std::move(outputs), error);
+    }
+}
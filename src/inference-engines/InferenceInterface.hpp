@@ -1,5 +1,13 @@
 #pragma once
 #include "common.hpp"
+#include "TensorView.hpp"
+#include <condition_variable>
+#include <deque>
+#include <functional>
+#include <future>
+#include <limits>
+#include <mutex>
+#include <thread>
 
 class InferenceInterface{
     	
@@ -10,20 +18,110 @@ class InferenceInterface{
 
         }
 
-
+        // Backends call shutdown_async first in their own destructor
+        virtual ~InferenceInterface();
 
         static void SetLogger(const std::shared_ptr<spdlog::logger>& logger) 
         {
             logger_ = logger;
         }
 
+        // Persistent input arena of the engine, preprocessing can write the blob straight into it.
+        // Backends with a known input shape allocate it at construction, otherwise it is
+        // allocated by the first blob written into it and reused as long as the shape is unchanged.
+        cv::Mat& get_input_blob()
+        {
+            return input_blob_;
+        }
         
-        virtual std::tuple<std::vector<std::vector<std::any>>, std::vector<std::vector<int64_t>>> get_infer_results(const cv::Mat& input_blob) = 0;
+        virtual std::vector<TensorView> get_infer_results(const cv::Mat& input_blob) = 0;
+
+        // Largest batch a single get_infer_results call accepts, 1 when the model batch dimension is static
+        virtual size_t max_batch_size() const
+        {
+            return 1;
+        }
+
+        // Reshapes the input arena to n x C x H x W and returns its n image slices (1 x C x H x W),
+        // preprocessing frames straight into them saves the packing copy of get_infer_results_batch.
+        // Empty when the input shape isn't known yet.
+        std::vector<cv::Mat> get_input_batch(size_t n);
+
+        // Batched inference over preprocessed 1 x C x H x W blobs: they are packed into one
+        // N x C x H x W input (in chunks of max_batch_size()) and every image gets views over
+        // its own slice of the outputs, which Detector::postprocess decodes as a batch 1 output
+        std::vector<std::vector<TensorView>> get_infer_results_batch(const std::vector<cv::Mat>& input_blobs);
+
+        // True when the returned views point into buffers the next get_infer_results overwrites,
+        // callers keeping outputs across calls (pipelined loop) must copy them first
+        virtual bool output_buffers_reused() const
+        {
+            return false;
+        }
+
+        // Asynchronous inference: the blob is copied before returning so it can be reused right away,
+        // the outputs own their data and a failed inference rethrows from the future's get().
+        // Blocks while max_outstanding() requests are in flight.
+        // Don't mix with get_infer_results calls from other threads on the same engine.
+        std::future<std::vector<TensorView>> infer_async(const cv::Mat& input_blob);
+
+        // Blocks until every infer_async request has completed
+        void wait_async();
+
+        // Requests infer_async keeps in flight at once
+        size_t max_outstanding() const
+        {
+            return max_outstanding_;
+        }
+
+        void set_max_outstanding(size_t max_outstanding)
+        {
+            max_outstanding_ = std::max<size_t>(max_outstanding, 1);
+        }
 
     protected:
-        std::vector<float> blob2vec(const cv::Mat& input_blob);
+        // error is set, and outputs empty, when the inference failed
+        using AsyncCallback = std::function<void(std::vector<TensorView>&& outputs, std::exception_ptr error)>;
+
+        // Backends with a native asynchronous API override it. on_complete may run on any thread and gets
+        // views owning their data. By default requests are queued to a worker thread running get_infer_results,
+        // a single one as the backends keep per engine state (input arena, bound tensors) between calls.
+        virtual void submit_async(const cv::Mat& input_blob, AsyncCallback on_complete);
+
+        // Waits for the infer_async requests and stops the worker thread. The worker and native
+        // completion callbacks call into the backend, so they must be done before its members go.
+        void shutdown_async();
+
+        // Copy the blob into the input arena unless it was preprocessed in place,
+        // returns true when the arena moved since the last call and backend tensors must be rebound
+        bool stage_input(const cv::Mat& input_blob);
+        // Copy count blobs into consecutive slices of the input arena, skipping the ones already in place
+        void pack_batch(const cv::Mat* input_blobs, size_t count);
         static std::shared_ptr<spdlog::logger> logger_; 
+        cv::Mat input_blob_;
+        size_t max_outstanding_{1};
+
+    private:
+        struct PendingRequest
+        {
+            cv::Mat input_blob;
+            AsyncCallback on_complete;
+        };
+
+        void async_worker();
+
+        const uchar* bound_input_data_{nullptr};
+        std::vector<int> bound_input_shape_;
 
+        std::mutex outstanding_mutex_;
+        std::condition_variable outstanding_changed_;
+        size_t outstanding_{0};
 
+        std::mutex worker_mutex_;
+        std::condition_variable worker_wakeup_;
+        std::deque<PendingRequest> pending_;
+        std::vector<cv::Mat> spare_blobs_;  // Input copies of completed requests, reused by the next ones
+        std::thread worker_;
+        bool stop_worker_{false};
 
-};
\ No newline at end of file
+};
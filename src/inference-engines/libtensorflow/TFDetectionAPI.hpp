@@ -27,6 +27,7 @@ public:
     }
 
     ~TFDetectionAPI() {
+        shutdown_async();
         tensorflow::Status status = session_->Close();
         if (!status.ok()) {
             std::cerr << "Error closing TensorFlow session: " << status.ToString() << std::endl;
@@ -38,6 +39,8 @@ private:
     std::string model_path_;
     tensorflow::SavedModelBundle bundle_;   
     std::unique_ptr<tensorflow::Session> session_; 
+    std::vector<std::pair<std::string, tensorflow::Tensor>> inputs_;
+    const std::vector<std::string> output_names_{"StatefulPartitionedCall:0", "StatefulPartitionedCall:1", "StatefulPartitionedCall:2", "StatefulPartitionedCall:3", "StatefulPartitionedCall:4"};
     
-    std::tuple<std::vector<std::vector<std::any>>, std::vector<std::vector<int64_t>>> get_infer_results(const cv::Mat& input_blob) override;    
+    std::vector<TensorView> get_infer_results(const cv::Mat& input_blob) override;    
 };
\ No newline at end of file
@@ -18,91 +18,61 @@ LibtorchInfer::LibtorchInfer(const std::string& model_path, bool use_gpu) : Infe
 
 }
 
-std::tuple<std::vector<std::vector<std::any>>, std::vector<std::vector<int64_t>>> LibtorchInfer::get_infer_results(const cv::Mat& input_blob)
+std::vector<TensorView> LibtorchInfer::get_infer_results(const cv::Mat& input_blob)
 {
 
-    // Convert the input tensor to a Torch tensor
-    torch::Tensor input = torch::from_blob(input_blob.data, { 1, input_blob.size[1], input_blob.size[2], input_blob.size[3] }, torch::kFloat32);
-    input = input.to(device_);
+    // The torch tensors wrapping the input arena are only rebuilt when the arena moves
+    if (stage_input(input_blob))
+    {
+        host_input_ = torch::from_blob(input_blob_.data, { input_blob_.size[0], input_blob_.size[1], input_blob_.size[2], input_blob_.size[3] }, torch::kFloat32);
+        inputs_.clear();
+        inputs_.push_back(host_input_.to(device_));
+    }
+    else if (device_ != torch::kCPU)
+    {
+        // Refresh the preallocated device copy in place
+        inputs_.front().toTensor().copy_(host_input_);
+    }
 
     // Run inference
-    std::vector<torch::jit::IValue> inputs;
-    inputs.push_back(input);
-    auto output = module_.forward(inputs);
-
-    std::vector<std::vector<std::any>> output_vectors;
-    std::vector<std::vector<int64_t>> shape_vectors;
-
-    if (output.isTuple()) {
-        // Handle the case where the model returns a tuple
-        auto tuple_outputs = output.toTuple()->elements();
-
-        for (const auto& output_tensor : tuple_outputs) {
-            if(!output_tensor.isTensor())
-                continue;
-            torch::Tensor tensor = output_tensor.toTensor().to(torch::kCPU).contiguous();
-
-            // Get the output data type
-            torch::ScalarType data_type = tensor.scalar_type();
+    auto output = module_.forward(inputs_);
 
-            // Store the output data based on its type
-            std::vector<std::any> tensor_data;
-            if (data_type == torch::kFloat32) {
-                const float* output_data = tensor.data_ptr<float>();
-                tensor_data.reserve(tensor.numel());
-                for (size_t i = 0; i < tensor.numel(); ++i) {
-                    tensor_data.emplace_back(output_data[i]);
-                }
-            } else if (data_type == torch::kInt64) {
-                const int64_t* output_data = tensor.data_ptr<int64_t>();
-                tensor_data.reserve(tensor.numel());
-                for (size_t i = 0; i < tensor.numel(); ++i) {
-                    tensor_data.emplace_back(output_data[i]);
-                }
-            } else {
-                // Handle other data types if needed
-                std::exit(1);
-            }
+    std::vector<TensorView> output_vectors;
 
-            // Store the output data in the outputs vector
-            output_vectors.push_back(tensor_data);
+    // Wrap a cpu contiguous copy of the tensor, the view holds a reference to its storage
+    auto add_output = [&output_vectors](const torch::Tensor& output_tensor) {
+        auto tensor = std::make_shared<torch::Tensor>(output_tensor.to(torch::kCPU).contiguous());
 
-            // Get the shape of the output tensor
-            std::vector<int64_t> shape = tensor.sizes().vec();
-            shape_vectors.push_back(shape);
-        }
-    } else {
-        torch::Tensor tensor = output.toTensor().to(torch::kCPU).contiguous();
-
-        // Get the output data type
-        torch::ScalarType data_type = tensor.scalar_type();
+        // Get the shape of the output tensor
+        std::vector<int64_t> shape = tensor->sizes().vec();
 
         // Store the output data based on its type
-        std::vector<std::any> tensor_data;
+        const torch::ScalarType data_type = tensor->scalar_type();
         if (data_type == torch::kFloat32) {
-            const float* output_data = tensor.data_ptr<float>();
-            tensor_data.reserve(tensor.numel());
-            for (size_t i = 0; i < tensor.numel(); ++i) {
-                tensor_data.emplace_back(output_data[i]);
-            }
+            output_vectors.emplace_back(TensorType::Float32, std::move(shape), tensor->data_ptr<float>(), tensor);
+        } else if (data_type == torch::kInt32) {
+            output_vectors.emplace_back(TensorType::Int32, std::move(shape), tensor->data_ptr<int32_t>(), tensor);
         } else if (data_type == torch::kInt64) {
-            const int64_t* output_data = tensor.data_ptr<int64_t>();
-            tensor_data.reserve(tensor.numel());
-            for (size_t i = 0; i < tensor.numel(); ++i) {
-                tensor_data.emplace_back(output_data[i]);
-            }
+            output_vectors.emplace_back(TensorType::Int64, std::move(shape), tensor->data_ptr<int64_t>(), tensor);
         } else {
             // Handle other data types if needed
+            logger_->error("Unsupported output tensor data type");
             std::exit(1);
         }
+    };
 
-        // Store the output data in the outputs vector
-        output_vectors.push_back(tensor_data);
+    if (output.isTuple()) {
+        // Handle the case where the model returns a tuple
+        auto tuple_outputs = output.toTuple()->elements();
 
-        // Get the shape of the output tensor
-        std::vector<int64_t> shape = tensor.sizes().vec();
-        shape_vectors.push_back(shape);
+        for (const auto& output_tensor : tuple_outputs) {
+            if(!output_tensor.isTensor())
+                continue;
+            add_output(output_tensor.toTensor());
+        }
+    } else {
+        add_output(output.toTensor());
     }
 
-    return std::make_tuple(output_vectors, shape_vectors);
+    return output_vectors;
 }
@@ -8,10 +8,15 @@ class LibtorchInfer : public InferenceInterface
 protected:
     torch::DeviceType device_;
     torch::jit::script::Module module_;
+    torch::Tensor host_input_;                  // View over the input arena
+    std::vector<torch::jit::IValue> inputs_;    // Forward arguments, on device_
 
 public:
     LibtorchInfer(const std::string& model_path, bool use_gpu = true);
+    ~LibtorchInfer() override { shutdown_async(); }
 
-    std::tuple<std::vector<std::vector<std::any>>, std::vector<std::vector<int64_t>>> get_infer_results(const cv::Mat& input_blob) override;
+    std::vector<TensorView> get_infer_results(const cv::Mat& input_blob) override;
+    // TorchScript doesn't expose input shapes, the batch size is whatever the module accepts
+    size_t max_batch_size() const override { return std::numeric_limits<size_t>::max(); }
   
 };
\ No newline at end of file
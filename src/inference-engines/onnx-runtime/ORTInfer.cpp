@@ -1,6 +1,7 @@
 #include "ORTInfer.hpp"
 
-ORTInfer::ORTInfer(const std::string& model_path, bool use_gpu) : InferenceInterface{model_path, "", use_gpu}
+ORTInfer::ORTInfer(const std::string& model_path, bool use_gpu, bool use_io_binding,
+    int num_threads, Ort::PrepackedWeightsContainer* prepacked_weights) : InferenceInterface{model_path, "", use_gpu}
 {
     env_=Ort::Env(ORT_LOGGING_LEVEL_WARNING, "Onnx Runtime Inference");
 
@@ -21,6 +22,8 @@ ORTInfer::ORTInfer(const std::string& model_path, bool use_gpu) : InferenceInter
                 logger_->info("Using CUDA GPU");
                 OrtCUDAProviderOptions cuda_options;
                 session_options.AppendExecutionProvider_CUDA(cuda_options);
+                // Host side buffers would be copied to the device at bind time, keep the plain Run path
+                use_io_binding = false;
                 is_found = true;
                 break;
             }
@@ -38,9 +41,17 @@ ORTInfer::ORTInfer(const std::string& model_path, bool use_gpu) : InferenceInter
         session_options = Ort::SessionOptions();
     }
 
+    if (num_threads > 0)
+    {
+        logger_->info("Intra op threads {}", num_threads);
+        session_options.SetIntraOpNumThreads(num_threads);
+    }
+
     try
     {
-        session_ = Ort::Session(env_, model_path.c_str(), session_options);
+        session_ = prepacked_weights ?
+            Ort::Session(env_, model_path.c_str(), session_options, *prepacked_weights) :
+            Ort::Session(env_, model_path.c_str(), session_options);
     }
     catch (const Ort::Exception& ex)
     {
@@ -56,6 +67,11 @@ ORTInfer::ORTInfer(const std::string& model_path, bool use_gpu) : InferenceInter
         auto input_shapes = session_.GetInputTypeInfo(i).GetTensorTypeAndShapeInfo().GetShape();
         auto input_type = session_.GetInputTypeInfo(i).GetTensorTypeAndShapeInfo().GetElementType(); 
         logger_->info("\t{} : {}", input_names_.at(i), print_shape(input_shapes));
+        if (i == 0)
+        {
+            dynamic_batch_ = input_shapes[0] == -1;
+        }
+        // Dynamic batch defaults to 1, batched calls reshape the input arena
         input_shapes[0] = input_shapes[0] == -1 ? 1 : input_shapes[0]; 
         input_shapes_.emplace_back(input_shapes);
 
@@ -93,6 +109,38 @@ ORTInfer::ORTInfer(const std::string& model_path, bool use_gpu) : InferenceInter
         auto output_shapes = session_.GetOutputTypeInfo(i).GetTensorTypeAndShapeInfo().GetShape();
         logger_->info("\t{} : {}", output_names_.at(i), print_shape(output_shapes));
         output_shapes_.emplace_back(output_shapes);
+        output_types_.emplace_back(session_.GetOutputTypeInfo(i).GetTensorTypeAndShapeInfo().GetElementType());
+    }
+
+    // Names, memory info and input tensors are built once and reused for every Run
+    std::transform(input_names_.begin(), input_names_.end(), std::back_inserter(input_names_char_),
+        [](const std::string& str) { return str.c_str(); });
+    std::transform(output_names_.begin(), output_names_.end(), std::back_inserter(output_names_char_),
+        [](const std::string& str) { return str.c_str(); });
+    memory_info_ = Ort::MemoryInfo::CreateCpu(OrtAllocatorType::OrtArenaAllocator, OrtMemType::OrtMemTypeDefault);
+
+    if (use_io_binding)
+    {
+        logger_->info("Using IoBinding with preallocated output buffers");
+        io_binding_ = Ort::IoBinding(session_);
+    }
+
+#if ORT_API_VERSION >= 16
+    // RunAsync calls share the intra op thread pool, a second one in flight hides the per call overhead.
+    // Without num_threads ORT sizes the pool to the cores, hardware_concurrency is the closest estimate.
+    const unsigned intra_op_threads = num_threads > 0 ? static_cast<unsigned>(num_threads) : std::thread::hardware_concurrency();
+    use_run_async_ = intra_op_threads >= 2;
+    if (use_run_async_)
+    {
+        max_outstanding_ = 2;
+    }
+#endif
+
+    // With a static input shape the input arena can be allocated upfront, dynamic shapes are bound on the first frame
+    if (std::none_of(input_shapes_[0].begin(), input_shapes_[0].end(), [](int64_t d) { return d <= 0; }))
+    {
+        const std::vector<int> input_dims(input_shapes_[0].begin(), input_shapes_[0].end());
+        input_blob_.create(input_dims, CV_32F);
     }
 }
 
@@ -121,101 +169,229 @@ size_t ORTInfer::getSizeByDim(const std::vector<int64_t>& dims)
 }
 
 
-std::tuple<std::vector<std::vector<std::any>>, std::vector<std::vector<int64_t>>> ORTInfer::get_infer_results(const cv::Mat& input_blob)
+void ORTInfer::bind_inputs()
 {
-    std::vector<std::vector<std::any>> outputs;
-    std::vector<std::vector<int64_t>> shapes;
-    std::vector<std::vector<float>> input_tensors(session_.GetInputCount());
-    std::vector<Ort::Value> in_ort_tensors;
-    Ort::MemoryInfo memory_info = Ort::MemoryInfo::CreateCpu(OrtAllocatorType::OrtArenaAllocator, OrtMemType::OrtMemTypeDefault);
-    std::vector<int64_t>  orig_target_sizes; 
-
-    input_tensors[0] = blob2vec(input_blob);
-    in_ort_tensors.emplace_back(Ort::Value::CreateTensor<float>(
-        memory_info,
-        input_tensors[0].data(),
-        getSizeByDim(input_shapes_[0]),
-        input_shapes_[0].data(),
-        input_shapes_[0].size()
+    in_ort_tensors_.clear();
+    input_tensor_shape_.assign(input_blob_.size.p, input_blob_.size.p + input_blob_.dims);
+    in_ort_tensors_.emplace_back(Ort::Value::CreateTensor<float>(
+        memory_info_,
+        input_blob_.ptr<float>(),
+        input_blob_.total(),
+        input_tensor_shape_.data(),
+        input_tensor_shape_.size()
     ));
 
     // RTDETR case, two inputs
-    if(input_tensors.size() > 1)
-    {
-        orig_target_sizes = { static_cast<int64_t>(input_blob.size[2]), static_cast<int64_t>(input_blob.size[3]) };
-        // Assuming input_tensors[1] is of type int64
-        in_ort_tensors.emplace_back(Ort::Value::CreateTensor<int64>(
-            memory_info,
-            orig_target_sizes.data(),
-            getSizeByDim( orig_target_sizes),
-            input_shapes_[1].data(),
-            input_shapes_[1].size()
+    if(input_names_.size() > 1)
+    {
+        // One target size per image of the batch
+        orig_target_sizes_.clear();
+        for (int64_t b = 0; b < input_tensor_shape_[0]; ++b)
+        {
+            orig_target_sizes_.insert(orig_target_sizes_.end(), { input_tensor_shape_[2], input_tensor_shape_[3] });
+        }
+        orig_target_sizes_shape_ = input_shapes_[1];
+        orig_target_sizes_shape_[0] = input_tensor_shape_[0];
+        // Assuming the second input is of type int64
+        in_ort_tensors_.emplace_back(Ort::Value::CreateTensor<int64_t>(
+            memory_info_,
+            orig_target_sizes_.data(),
+            orig_target_sizes_.size(),
+            orig_target_sizes_shape_.data(),
+            orig_target_sizes_shape_.size()
         ));
     }
 
+    if (io_binding_)
+    {
+        io_binding_.ClearBoundInputs();
+        for (size_t i = 0; i < in_ort_tensors_.size(); ++i)
+        {
+            io_binding_.BindInput(input_names_char_[i], in_ort_tensors_[i]);
+        }
+        // Output shapes can follow the input shape, so outputs are bound again as well
+        bind_outputs();
+    }
+}
 
-    // Run inference
-    std::vector<const char*> input_names_char(input_names_.size());
-    std::transform(input_names_.begin(), input_names_.end(), input_names_char.begin(),
-        [](const std::string& str) { return str.c_str(); });
 
-    std::vector<const char*> output_names_char(output_names_.size());
-    std::transform(output_names_.begin(), output_names_.end(), output_names_char.begin(),
-        [](const std::string& str) { return str.c_str(); });
+void ORTInfer::bind_outputs()
+{
+    io_binding_.ClearBoundOutputs();
+    bound_outputs_ = std::make_shared<std::vector<Ort::Value>>();
+    has_dynamic_outputs_ = false;
 
-    std::vector<Ort::Value> output_ort_tensors = session_.Run(
-        Ort::RunOptions{ nullptr },
-        input_names_char.data(),
-        in_ort_tensors.data(),
-        in_ort_tensors.size(),
-        output_names_char.data(),
-        output_names_.size()
-    );
+    Ort::AllocatorWithDefaultOptions allocator;
+    for (size_t i = 0; i < output_names_.size(); ++i)
+    {
+        std::vector<int64_t> shape = output_shapes_[i];
+        shape[0] = shape[0] == -1 ? input_tensor_shape_[0] : shape[0];
+        if (std::any_of(shape.begin(), shape.end(), [](int64_t d) { return d <= 0; }))
+        {
+            // Shape only known after a run and may change with the data, ORT allocates it on every run
+            bound_outputs_->emplace_back(nullptr);
+            io_binding_.BindOutput(output_names_char_[i], memory_info_);
+            has_dynamic_outputs_ = true;
+            continue;
+        }
+        bound_outputs_->emplace_back(Ort::Value::CreateTensor(allocator, shape.data(), shape.size(), output_types_[i]));
+        io_binding_.BindOutput(output_names_char_[i], bound_outputs_->back());
+    }
+}
 
-    // Process output tensors
-    assert(output_ort_tensors.size() == output_names_.size());
 
-    for (const Ort::Value& output_tensor : output_ort_tensors)
+std::vector<TensorView> ORTInfer::get_infer_results(const cv::Mat& input_blob)
+{
+    if (stage_input(input_blob))
     {
-        const auto& shape_ref = output_tensor.GetTensorTypeAndShapeInfo().GetShape();
-        std::vector<int64_t> shape(shape_ref.begin(), shape_ref.end());
+        bind_inputs();
+    }
 
-        size_t num_elements = 1;
-        for (int64_t dim : shape) {
-            num_elements *= dim;
+    // The views point straight into the ORT owned buffers, keep them alive with the views
+    std::shared_ptr<std::vector<Ort::Value>> owner;
+    if (io_binding_)
+    {
+        session_.Run(Ort::RunOptions{ nullptr }, io_binding_);
+        if (has_dynamic_outputs_)
+        {
+            // The static outputs are still the preallocated buffers, the dynamic ones are this run's
+            owner = std::make_shared<std::vector<Ort::Value>>(io_binding_.GetOutputValues());
+        }
+        else
+        {
+            owner = bound_outputs_;
         }
-        
-        std::vector<std::any> tensor_data;
-        
+    }
+    else
+    {
+        // Run inference
+        std::vector<Ort::Value> output_ort_tensors = session_.Run(
+            Ort::RunOptions{ nullptr },
+            input_names_char_.data(),
+            in_ort_tensors_.data(),
+            in_ort_tensors_.size(),
+            output_names_char_.data(),
+            output_names_char_.size()
+        );
+        owner = std::make_shared<std::vector<Ort::Value>>(std::move(output_ort_tensors));
+    }
+
+    assert(owner->size() == output_names_.size());
+    return make_views(*owner, owner);
+}
+
+
+std::vector<TensorView> ORTInfer::make_views(const std::vector<Ort::Value>& values, const std::shared_ptr<const void>& owner)
+{
+    std::vector<TensorView> outputs;
+    for (const Ort::Value& output_tensor : values)
+    {
+        const auto tensor_info = output_tensor.GetTensorTypeAndShapeInfo();
+        std::vector<int64_t> shape = tensor_info.GetShape();
+
         // Retrieve tensor data
-        const int onnx_type = output_tensor.GetTensorTypeAndShapeInfo().GetElementType();
-        switch(onnx_type) {
-            case ONNXTensorElementDataType::ONNX_TENSOR_ELEMENT_DATA_TYPE_FLOAT: {
-                const float* output_data_float = output_tensor.GetTensorData<float>();
-                tensor_data.reserve(num_elements);
-                for (size_t i = 0; i < num_elements; ++i) {
-                    tensor_data.emplace_back(output_data_float[i]);
-                }
+        switch(tensor_info.GetElementType()) {
+            case ONNXTensorElementDataType::ONNX_TENSOR_ELEMENT_DATA_TYPE_FLOAT:
+                outputs.emplace_back(TensorType::Float32, std::move(shape), output_tensor.GetTensorData<float>(), owner);
                 break;
-            }
-            case ONNXTensorElementDataType::ONNX_TENSOR_ELEMENT_DATA_TYPE_INT64: {
-                const int64_t* output_data_int64 = output_tensor.GetTensorData<int64_t>();
-                tensor_data.reserve(num_elements);
-                for (size_t i = 0; i < num_elements; ++i) {
-                    tensor_data.emplace_back(output_data_int64[i]);
-                }
+            case ONNXTensorElementDataType::ONNX_TENSOR_ELEMENT_DATA_TYPE_INT32:
+                outputs.emplace_back(TensorType::Int32, std::move(shape), output_tensor.GetTensorData<int32_t>(), owner);
+                break;
+            case ONNXTensorElementDataType::ONNX_TENSOR_ELEMENT_DATA_TYPE_INT64:
+                outputs.emplace_back(TensorType::Int64, std::move(shape), output_tensor.GetTensorData<int64_t>(), owner);
                 break;
-            }
             // Add cases for other data types as needed
             default:
+                logger_->error("Unsupported output tensor data type");
                 std::exit(1);
         }
+    }
+
+    return outputs;
+}
+
+#if ORT_API_VERSION >= 16
+// Session::RunAsync runs on the intra op thread pool, every call gets its own input copy and outputs
+// allocated by ORT, so several frames can be in flight without touching the synchronous path state
+void ORTInfer::submit_async(const cv::Mat& input_blob, AsyncCallback on_complete)
+{
+    if (!use_run_async_)
+    {
+        InferenceInterface::submit_async(input_blob, std::move(on_complete));
+        return;
+    }
+
+    auto run = std::make_unique<AsyncRun>();
+    run->engine = this;
+    input_blob.copyTo(run->input_blob);
+    run->input_shape.assign(run->input_blob.size.p, run->input_blob.size.p + run->input_blob.dims);
+    run->inputs.emplace_back(Ort::Value::CreateTensor<float>(
+        memory_info_,
+        run->input_blob.ptr<float>(),
+        run->input_blob.total(),
+        run->input_shape.data(),
+        run->input_shape.size()
+    ));
 
-        // Store the tensor data in outputs
-        outputs.emplace_back(tensor_data);
-        shapes.emplace_back(shape);
+    // RTDETR case, two inputs
+    if (input_names_.size() > 1)
+    {
+        for (int64_t b = 0; b < run->input_shape[0]; ++b)
+        {
+            run->orig_target_sizes.insert(run->orig_target_sizes.end(), { run->input_shape[2], run->input_shape[3] });
+        }
+        run->orig_target_sizes_shape = input_shapes_[1];
+        run->orig_target_sizes_shape[0] = run->input_shape[0];
+        run->inputs.emplace_back(Ort::Value::CreateTensor<int64_t>(
+            memory_info_,
+            run->orig_target_sizes.data(),
+            run->orig_target_sizes.size(),
+            run->orig_target_sizes_shape.data(),
+            run->orig_target_sizes_shape.size()
+        ));
     }
 
-    return std::make_tuple(outputs, shapes);
+    run->outputs.resize(output_names_.size());
+    run->on_complete = std::move(on_complete);
+    AsyncRun* user_data = run.get();
+    session_.RunAsync(
+        Ort::RunOptions{ nullptr },
+        input_names_char_.data(),
+        user_data->inputs.data(),
+        user_data->inputs.size(),
+        output_names_char_.data(),
+        user_data->outputs.data(),
+        user_data->outputs.size(),
+        &ORTInfer::on_run_async_done,
+        user_data
+    );
+    // Owned by the completion callback from now on
+    run.release();
 }
 
+
+void ORTInfer::on_run_async_done(void* user_data, OrtValue** outputs, size_t num_outputs, OrtStatusPtr status)
+{
+    std::shared_ptr<AsyncRun> run(static_cast<AsyncRun*>(user_data));
+    if (status != nullptr)
+    {
+        // Runs on an ORT thread, the failure is rethrown to whoever waits for the result
+        Ort::Status error(status);
+        AsyncCallback on_complete = std::move(run->on_complete);
+        on_complete({}, std::make_exception_ptr(std::runtime_error("Asynchronous inference failed: " + error.GetErrorMessage())));
+        return;
+    }
+
+    // ORT fills the output array passed to RunAsync, adopt the values it didn't write in place
+    for (size_t i = 0; i < num_outputs; ++i)
+    {
+        if (!run->outputs[i])
+        {
+            run->outputs[i] = Ort::Value(outputs[i]);
+        }
+    }
+    std::vector<TensorView> views = run->engine->make_views(run->outputs, run);
+    AsyncCallback on_complete = std::move(run->on_complete);
+    on_complete(std::move(views), nullptr);
+}
+#endif
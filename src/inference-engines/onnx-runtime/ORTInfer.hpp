@@ -12,11 +12,58 @@ private:
     std::vector<std::string> output_names_; // Store output layer names
     std::vector<std::vector<int64_t>> input_shapes_;
     std::vector<std::vector<int64_t>> output_shapes_;
+    std::vector<const char*> input_names_char_;
+    std::vector<const char*> output_names_char_;
+    Ort::MemoryInfo memory_info_{ nullptr };
+    std::vector<Ort::Value> in_ort_tensors_;  // Views over the input arena, rebuilt only when it moves
+    std::vector<int64_t> input_tensor_shape_;
+    std::vector<int64_t> orig_target_sizes_;
+    std::vector<int64_t> orig_target_sizes_shape_;
+    bool dynamic_batch_{ false };
+    std::vector<ONNXTensorElementDataType> output_types_;
+
+    // IoBinding mode (opt-in), static shape outputs are written into buffers bound once and reused
+    // across frames, outputs with a data dependent shape are allocated by ORT on every run
+    Ort::IoBinding io_binding_{ nullptr };
+    std::shared_ptr<std::vector<Ort::Value>> bound_outputs_;
+    bool has_dynamic_outputs_{ false };
+
+    void bind_inputs();
+    void bind_outputs();
+    std::vector<TensorView> make_views(const std::vector<Ort::Value>& values, const std::shared_ptr<const void>& owner);
+
+#if ORT_API_VERSION >= 16
+    // State of one Session::RunAsync call, kept alive by the output views
+    struct AsyncRun
+    {
+        ORTInfer* engine;
+        cv::Mat input_blob;
+        std::vector<int64_t> input_shape;
+        std::vector<int64_t> orig_target_sizes;
+        std::vector<int64_t> orig_target_sizes_shape;
+        std::vector<Ort::Value> inputs;
+        std::vector<Ort::Value> outputs;
+        AsyncCallback on_complete;
+    };
+
+    // RunAsync needs an intra op pool of at least 2 threads, else requests go to the default worker
+    bool use_run_async_{ false };
+
+    void submit_async(const cv::Mat& input_blob, AsyncCallback on_complete) override;
+    static void on_run_async_done(void* user_data, OrtValue** outputs, size_t num_outputs, OrtStatusPtr status);
+#endif
 
 public:
     std::string print_shape(const std::vector<std::int64_t>& v);
-    ORTInfer(const std::string& model_path, bool use_gpu = false);
+    // num_threads (when > 0) caps the intra op thread pool, sessions created with the same
+    // prepacked weights container share the prepacked copies of their weights (engine pool replicas).
+    // use_io_binding runs through an IoBinding with preallocated outputs (CPU only)
+    ORTInfer(const std::string& model_path, bool use_gpu = false, bool use_io_binding = false,
+        int num_threads = 0, Ort::PrepackedWeightsContainer* prepacked_weights = nullptr);
+    ~ORTInfer() override { shutdown_async(); }
     size_t getSizeByDim(const std::vector<int64_t>& dims);
 
-    std::tuple<std::vector<std::vector<std::any>>, std::vector<std::vector<int64_t>>> get_infer_results(const cv::Mat& input_blob) override;
+    std::vector<TensorView> get_infer_results(const cv::Mat& input_blob) override;
+    bool output_buffers_reused() const override { return static_cast<bool>(io_binding_); }
+    size_t max_batch_size() const override { return dynamic_batch_ ? std::numeric_limits<size_t>::max() : 1; }
 };
\ No newline at end of file
@@ -19,39 +19,35 @@ OCVDNNInfer::OCVDNNInfer(const std::string& weights, const std::string& modelCon
 }
 
 
-std::tuple<std::vector<std::vector<std::any>>, std::vector<std::vector<int64_t>>> OCVDNNInfer::get_infer_results(const cv::Mat& input_blob)
+std::vector<TensorView> OCVDNNInfer::get_infer_results(const cv::Mat& input_blob)
 {
 
-        std::vector<std::vector<std::any>> outputs;
-        std::vector<std::vector<int64_t>> shapes;
-        std::vector<std::string> layerTypes;
+        std::vector<TensorView> outputs;
 
         std::vector<cv::Mat> outs;
         net_.setInput(input_blob);
         net_.forward(outs, outNames_);
 
         for (size_t i = 0; i < outs.size(); ++i) {
-            const auto& output = outs[i];
+            // cv::Mat is reference counted, the copy held by the view keeps the blob alive
+            auto output = std::make_shared<cv::Mat>(outs[i]);
             // Extracting dimensions of the output tensor
             std::vector<int64_t> shape;
-            for (int j = 0; j < output.dims; ++j) {
-                shape.push_back(output.size[j]);
+            for (int j = 0; j < output->dims; ++j) {
+                shape.push_back(output->size[j]);
             }
-            shapes.push_back(shape);
 
             // Extracting data
-            if (output.type() == CV_32F) {
-                const float* data = output.ptr<float>();
-                outputs.emplace_back(data, data + output.total());
+            if (output->type() == CV_32F) {
+                outputs.emplace_back(TensorType::Float32, std::move(shape), output->ptr<float>(), output);
             } 
-            else if (output.type() == CV_64F) {
-                const int64_t* data = output.ptr<int64_t>();
-                outputs.emplace_back(data, data + output.total());
+            else if (output->type() == CV_32S) {
+                outputs.emplace_back(TensorType::Int32, std::move(shape), output->ptr<int32_t>(), output);
             } 
             else {
                 std::cerr << "Unsupported data type\n";
             }
         }
 
-        return std::make_tuple(outputs, shapes);
+        return outputs;
 }
\ No newline at end of file
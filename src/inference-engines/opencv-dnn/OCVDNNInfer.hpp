@@ -11,6 +11,9 @@ private:
         
 public:
     OCVDNNInfer(const std::string& weights, const std::string& modelConfiguration = "");
+    ~OCVDNNInfer() override { shutdown_async(); }
 
-    std::tuple<std::vector<std::vector<std::any>>, std::vector<std::vector<int64_t>>> get_infer_results(const cv::Mat& input_blob) override;
+    std::vector<TensorView> get_infer_results(const cv::Mat& input_blob) override;
+    // The network is reshaped to the input blob on every forward
+    size_t max_batch_size() const override { return std::numeric_limits<size_t>::max(); }
 };
@@ -1,31 +1,197 @@
 #include "OVInfer.hpp" 
 
-OVInfer::OVInfer(const std::string& model_path, const std::string& model_config, bool use_gpu) : 
+OVInfer::OVInfer(const std::string& model_path, const std::string& model_config, bool use_gpu,
+    bool throughput, int num_streams, int num_threads) : 
     InferenceInterface{model_path, model_config, use_gpu}
 {
 
     model_ = core_.read_model(model_config);
-    compiled_model_ = core_.compile_model(model_);
+    // Without hints the plugin compiles for latency, a single stream
+    ov::AnyMap config;
+    if (throughput)
+    {
+        config.emplace(ov::hint::performance_mode(ov::hint::PerformanceMode::THROUGHPUT));
+    }
+    if (num_streams > 0)
+    {
+        config.emplace(ov::num_streams(num_streams));
+    }
+    if (num_threads > 0)
+    {
+        config.emplace(ov::inference_num_threads(num_threads));
+    }
+    compiled_model_ = core_.compile_model(model_, config);
     infer_request_ = compiled_model_.create_infer_request();
-    ov::Shape s = compiled_model_.input().get_shape();
+    num_requests_ = std::max<uint32_t>(compiled_model_.get_property(ov::optimal_number_of_infer_requests), 1);
+    logger_->info("OpenVINO optimal number of infer requests {}", num_requests_);
+    max_outstanding_ = num_requests_;
+
+    // Input arena and the tensor wrapping it are created once, the request keeps reading from it.
+    // A dynamic batch dimension starts at 1, batched calls reshape the arena.
+    const ov::PartialShape input_shape = compiled_model_.input().get_partial_shape();
+    dynamic_batch_ = input_shape[0].is_dynamic();
+    std::vector<int> input_dims;
+    for (size_t i = 0; i < input_shape.size(); ++i)
+    {
+        if (input_shape[i].is_static())
+        {
+            input_dims.push_back(static_cast<int>(input_shape[i].get_length()));
+        }
+        else if (i == 0)
+        {
+            input_dims.push_back(1);
+        }
+        else
+        {
+            logger_->error("Only the batch dimension of the input can be dynamic {}", input_shape.to_string());
+            std::exit(1);
+        }
+    }
+    input_blob_.create(input_dims, CV_32F);
+    bind_input();
 }
 
-std::tuple<std::vector<std::vector<std::any>>, std::vector<std::vector<int64_t>>> OVInfer::get_infer_results(const cv::Mat& input_blob) 
+OVInfer::~OVInfer()
 {
-    
-    std::vector<std::vector<std::any>> outputs;
-    std::vector<std::vector<int64_t>> shapes;
+    // Callbacks reference this object, let the in flight requests finish first
+    shutdown_async();
+    wait_all();
+}
 
-    ov::Tensor input_tensor(compiled_model_.input().get_element_type(), compiled_model_.input().get_shape(), input_blob.data);
+void OVInfer::bind_input()
+{
+    const ov::Shape input_shape(input_blob_.size.p, input_blob_.size.p + input_blob_.dims);
+    input_tensor_ = ov::Tensor(compiled_model_.input().get_element_type(), input_shape, input_blob_.data);
     // Set input tensor for model with one input
-    infer_request_.set_input_tensor(input_tensor);    
+    infer_request_.set_input_tensor(input_tensor_);
+}
+
+std::vector<TensorView> OVInfer::get_infer_results(const cv::Mat& input_blob) 
+{
+    if (stage_input(input_blob))
+    {
+        bind_input();
+    }
     infer_request_.infer();
-    auto output_tensor = infer_request_.get_output_tensor();
-    const float *output_buffer = output_tensor.data<const float>();
-    std::size_t output_size = output_tensor.get_size();
-    std::vector<int64_t>output_shape(output_tensor.get_shape().begin(), output_tensor.get_shape().end());
-    std::vector<std::any> output(output_buffer, output_buffer + output_size);
-    outputs.emplace_back(output);
-    shapes.emplace_back(output_shape);
-    return std::make_tuple(outputs, shapes);
-}
\ No newline at end of file
+    return collect_outputs(infer_request_);
+}
+
+std::vector<TensorView> OVInfer::collect_outputs(ov::InferRequest& request)
+{
+    std::vector<TensorView> outputs;
+    for (size_t i = 0; i < compiled_model_.outputs().size(); ++i)
+    {
+        // ov::Tensor is reference counted, the copy held by the view keeps the request buffer alive
+        auto output_tensor = std::make_shared<ov::Tensor>(request.get_output_tensor(i));
+        const ov::Shape shape = output_tensor->get_shape();
+        std::vector<int64_t> output_shape(shape.begin(), shape.end());
+        const auto element_type = output_tensor->get_element_type();
+        if (element_type == ov::element::f32)
+            outputs.emplace_back(TensorType::Float32, std::move(output_shape), output_tensor->data<const float>(), output_tensor);
+        else if (element_type == ov::element::i32)
+            outputs.emplace_back(TensorType::Int32, std::move(output_shape), output_tensor->data<const int32_t>(), output_tensor);
+        else if (element_type == ov::element::i64)
+            outputs.emplace_back(TensorType::Int64, std::move(output_shape), output_tensor->data<const int64_t>(), output_tensor);
+        else
+        {
+            logger_->error("Unsupported output tensor data type {}", element_type.get_type_name());
+            std::exit(1);
+        }
+    }
+    return outputs;
+}
+
+void OVInfer::create_request_pool()
+{
+    for (size_t i = 0; i < num_requests_; ++i)
+    {
+        auto async_request = std::make_unique<AsyncRequest>();
+        async_request->request = compiled_model_.create_infer_request();
+        AsyncRequest* entry = async_request.get();
+        entry->request.set_callback([this, entry, i](std::exception_ptr error) {
+            // Runs on an OpenVINO thread, failures go to the callback and the request back to the pool
+            std::vector<TensorView> outputs;
+            if (!error)
+            {
+                try
+                {
+                    outputs = collect_outputs(entry->request);
+                }
+                catch (...)
+                {
+                    error = std::current_exception();
+                }
+            }
+            CompletionCallback on_complete = std::move(entry->on_complete);
+            entry->on_complete = nullptr;
+            on_complete(std::move(outputs), error);
+            {
+                std::lock_guard<std::mutex> lock(requests_mutex_);
+                free_requests_.push_back(i);
+            }
+            request_released_.notify_all();
+        });
+        requests_.push_back(std::move(async_request));
+        free_requests_.push_back(i);
+    }
+}
+
+void OVInfer::start_async(const cv::Mat& input_blob, CompletionCallback on_complete)
+{
+    size_t index;
+    {
+        std::unique_lock<std::mutex> lock(requests_mutex_);
+        if (requests_.empty())
+        {
+            create_request_pool();
+        }
+        request_released_.wait(lock, [this] { return !free_requests_.empty(); });
+        index = free_requests_.back();
+        free_requests_.pop_back();
+    }
+
+    // Every request owns its input, rebound only when the blob shape changes
+    AsyncRequest& entry = *requests_[index];
+    try
+    {
+        const bool rebind = entry.input_blob.empty() || entry.input_blob.size != input_blob.size;
+        input_blob.copyTo(entry.input_blob);
+        if (rebind)
+        {
+            const ov::Shape input_shape(entry.input_blob.size.p, entry.input_blob.size.p + entry.input_blob.dims);
+            entry.request.set_input_tensor(ov::Tensor(compiled_model_.input().get_element_type(), input_shape, entry.input_blob.data));
+        }
+        entry.on_complete = std::move(on_complete);
+        entry.request.start_async();
+    }
+    catch (...)
+    {
+        // Not started, the callback won't run: the request goes back to the pool, rebound on its next use
+        entry.input_blob.release();
+        entry.on_complete = nullptr;
+        {
+            std::lock_guard<std::mutex> lock(requests_mutex_);
+            free_requests_.push_back(index);
+        }
+        request_released_.notify_all();
+        throw;
+    }
+}
+
+// infer_async runs on the request pool, outputs are copied out before the request is reused
+void OVInfer::submit_async(const cv::Mat& input_blob, AsyncCallback on_complete)
+{
+    start_async(input_blob, [on_complete = std::move(on_complete)](std::vector<TensorView>&& outputs, std::exception_ptr error) {
+        for (TensorView& output : outputs)
+        {
+            output = output.clone();
+        }
+        on_complete(std::move(outputs), error);
+    });
+}
+
+void OVInfer::wait_all()
+{
+    std::unique_lock<std::mutex> lock(requests_mutex_);
+    request_released_.wait(lock, [this] { return free_requests_.size() == requests_.size(); });
+}
@@ -1,21 +1,62 @@
 #pragma once
 #include "InferenceInterface.hpp"
 #include <openvino/openvino.hpp>
+#include <condition_variable>
+#include <functional>
+#include <mutex>
 
 
 class OVInfer : public InferenceInterface
 {
 protected:
-
+    void bind_input();
 
 public:
-    OVInfer(const std::string& model_path = "", const std::string& modelConfiguration = "", bool use_gpu = true);
+    // Called on an OpenVINO thread when a request completes, the views are only valid during the call.
+    // error is set, and outputs empty, when the inference failed.
+    using CompletionCallback = std::function<void(std::vector<TensorView>&& outputs, std::exception_ptr error)>;
+
+    // throughput compiles with the THROUGHPUT hint, num_streams / num_threads (when > 0) set
+    // NUM_STREAMS / INFERENCE_NUM_THREADS explicitly instead of letting the plugin pick them
+    OVInfer(const std::string& model_path = "", const std::string& modelConfiguration = "", bool use_gpu = true,
+        bool throughput = false, int num_streams = 0, int num_threads = 0);
+    ~OVInfer();
+
+    std::vector<TensorView> get_infer_results(const cv::Mat& input_blob) override;
+    bool output_buffers_reused() const override { return true; }
+    size_t max_batch_size() const override { return dynamic_batch_ ? std::numeric_limits<size_t>::max() : 1; }
+
+    // Submits the blob to a free request of the pool (blocks while all are busy) and returns
+    // once the input is copied, so the caller can reuse its blob right away. Throws when the
+    // request can't be started, on_complete then never runs.
+    void start_async(const cv::Mat& input_blob, CompletionCallback on_complete);
+    // Blocks until every submitted request has completed and run its callback
+    void wait_all();
+    // Pool size, ov::optimal_number_of_infer_requests of the compiled model
+    size_t num_requests() const { return num_requests_; }
 
-    std::tuple<std::vector<std::vector<std::any>>, std::vector<std::vector<int64_t>>> get_infer_results(const cv::Mat& input_blob) override;
-  
     ov::Core core_;
     ov::Tensor input_tensor_;
     ov::InferRequest infer_request_;
     std::shared_ptr<ov::Model> model_;
     ov::CompiledModel compiled_model_;
-};
\ No newline at end of file
+    bool dynamic_batch_{false};
+
+private:
+    struct AsyncRequest
+    {
+        ov::InferRequest request;
+        cv::Mat input_blob;
+        CompletionCallback on_complete;
+    };
+
+    void submit_async(const cv::Mat& input_blob, AsyncCallback on_complete) override;
+    std::vector<TensorView> collect_outputs(ov::InferRequest& request);
+    void create_request_pool();
+
+    size_t num_requests_{1};
+    std::vector<std::unique_ptr<AsyncRequest>> requests_;
+    std::vector<size_t> free_requests_;
+    std::mutex requests_mutex_;
+    std::condition_variable request_released_;
+};
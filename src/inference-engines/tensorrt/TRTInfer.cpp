@@ -56,76 +56,111 @@ size_t TRTInfer::getSizeByDim(const nvinfer1::Dims& dims)
 
 
 
+// Dimensions of a binding for the current context shapes, in bytes
+size_t TRTInfer::binding_bytes(int binding)
+{
+    const size_t size = getSizeByDim(context_->getBindingDimensions(binding));
+    switch (engine_->getBindingDataType(binding))
+    {
+        case nvinfer1::DataType::kFLOAT:
+            return size * sizeof(float);
+        case nvinfer1::DataType::kINT32:
+            return size * sizeof(int32_t);
+        // Add more cases for other data types if needed
+        default:
+            // Handle unsupported data types
+            std::exit(1);
+    }
+    return 0;
+}
+
+
+// Dynamic batch engines: set the batch dimension of every input, the other dimensions come from the profile
+void TRTInfer::set_batch_size(int batch_size)
+{
+    for (size_t i = 0; i < num_inputs_; ++i)
+    {
+        if (engine_->getBindingDimensions(i).d[0] != -1)
+        {
+            continue;
+        }
+        nvinfer1::Dims dims = engine_->getProfileDimensions(i, 0, nvinfer1::OptProfileSelector::kMIN);
+        dims.d[0] = batch_size;
+        context_->setBindingDimensions(i, dims);
+    }
+    batch_size_ = batch_size;
+}
+
+
 void TRTInfer::createContextAndAllocateBuffers()
 {
-    nvinfer1::Dims profile_dims = engine_->getProfileDimensions(0, 0, nvinfer1::OptProfileSelector::kMIN);
-    int max_batch_size = profile_dims.d[0];
     context_ = engine_->createExecutionContext();
-    context_->setBindingDimensions(0, profile_dims);
+    for (int i = 0; i < engine_->getNbBindings(); ++i)
+    {
+        num_inputs_ += engine_->bindingIsInput(i) ? 1 : 0;
+    }
+    num_outputs_ = engine_->getNbBindings() - num_inputs_;
+
+    // Buffers are sized for the largest batch of the optimization profile, the context then starts at the smallest one
+    dynamic_batch_ = engine_->getBindingDimensions(0).d[0] == -1;
+    int min_batch_size = 1;
+    if (dynamic_batch_)
+    {
+        min_batch_size = engine_->getProfileDimensions(0, 0, nvinfer1::OptProfileSelector::kMIN).d[0];
+        max_batch_size_ = engine_->getProfileDimensions(0, 0, nvinfer1::OptProfileSelector::kMAX).d[0];
+        set_batch_size(max_batch_size_);
+        logger_->info("Dynamic batch engine, batch size {} to {}", min_batch_size, max_batch_size_);
+    }
+
     buffers_.resize(engine_->getNbBindings());
     for (int i = 0; i < engine_->getNbBindings(); ++i)
     {
-        nvinfer1::Dims dims = engine_->getBindingDimensions(i);
-        auto size = getSizeByDim(dims);
-        size_t binding_size;
-        switch (engine_->getBindingDataType(i)) 
-        {
-            case nvinfer1::DataType::kFLOAT:
-                binding_size = size * sizeof(float);
-                break;
-            case nvinfer1::DataType::kINT32:
-                binding_size = size * sizeof(int);
-                break;
-            // Add more cases for other data types if needed
-            default:
-                // Handle unsupported data types
-                std::exit(1);
-        }
+        const size_t binding_size = binding_bytes(i);
         cudaMalloc(&buffers_[i], binding_size);
-   
         if (engine_->bindingIsInput(i))
         {
-            logger_->info("Input layer {} {}",num_inputs_, engine_->getBindingName(i));
-            num_inputs_++;
+            logger_->info("Input layer {} {}", i, engine_->getBindingName(i));
             continue;
         }
-        logger_->info("Output layer {} {}",num_outputs_, engine_->getBindingName(i));
-        num_outputs_++;
+        logger_->info("Output layer {} {}", i - num_inputs_, engine_->getBindingName(i));
+        // Host side copy of the output binding, reused across frames
+        host_outputs_.emplace_back(std::make_shared<std::vector<uint8_t>>(binding_size));
+    }
+
+    if (dynamic_batch_)
+    {
+        set_batch_size(min_batch_size);
     }
+
+    // Host input arena for preprocessing, uploaded straight to the device binding
+    const nvinfer1::Dims dims = context_->getBindingDimensions(0);
+    input_blob_.create(std::vector<int>(dims.d, dims.d + dims.nbDims), CV_32F);
 }
-std::tuple<std::vector<std::vector<std::any>>, std::vector<std::vector<int64_t>>> TRTInfer::get_infer_results(const cv::Mat& input_blob)
+
+
+std::vector<TensorView> TRTInfer::get_infer_results(const cv::Mat& input_blob)
 {
-    for (size_t i = 0; i < num_inputs_; ++i)
+    const int batch_size = input_blob.size[0];
+    if (dynamic_batch_ && batch_size != batch_size_)
     {
-        nvinfer1::Dims dims = engine_->getBindingDimensions(i);
-        size_t size = getSizeByDim(dims);
-        size_t binding_size = 0;
-        switch (engine_->getBindingDataType(i))
+        if (batch_size > max_batch_size_)
         {
-            case nvinfer1::DataType::kFLOAT:
-                binding_size = size * sizeof(float);
-                break;
-            case nvinfer1::DataType::kINT32:
-                binding_size = size * sizeof(int32_t);
-                break;
-            // Add more cases for other data types if needed
-            default:
-                // Handle unsupported data types
-                std::exit(1);
-                break;
+            logger_->error("Batch size {} above the engine limit {}", batch_size, max_batch_size_);
+            std::exit(1);
         }
+        set_batch_size(batch_size);
+    }
 
-        switch(i)
+    cudaMemcpy(buffers_[0], input_blob.data, binding_bytes(0), cudaMemcpyHostToDevice);
+    if (num_inputs_ > 1)
+    {
+        // in rtdetr lyuwenyu version we have a second input, one target size per image
+        orig_target_sizes_.clear();
+        for (int b = 0; b < batch_size; ++b)
         {
-            case 0:
-                cudaMemcpy(buffers_[0], input_blob.data, binding_size, cudaMemcpyHostToDevice);
-                break;
-            case 1:
-                // in rtdetr lyuwenyu version we have a second input
-                std::vector<int32_t> orig_target_sizes = { static_cast<int32_t>(input_blob.size[2]), static_cast<int32_t>(input_blob.size[3]) };
-                cudaMemcpy(buffers_[1], orig_target_sizes.data(), binding_size, cudaMemcpyHostToDevice);
-                break;
+            orig_target_sizes_.insert(orig_target_sizes_.end(), { static_cast<int32_t>(input_blob.size[2]), static_cast<int32_t>(input_blob.size[3]) });
         }
+        cudaMemcpy(buffers_[1], orig_target_sizes_.data(), binding_bytes(1), cudaMemcpyHostToDevice);
     }
 
     if(!context_->enqueueV2(buffers_.data(), 0, nullptr))
@@ -134,29 +169,23 @@ std::tuple<std::vector<std::vector<std::any>>, std::vector<std::vector<int64_t>>
         std::exit(1);
     }
     
-    std::vector<std::vector<int64_t>> output_shapes;
-    std::vector<std::vector<std::any>> outputs;
+    std::vector<TensorView> outputs;
     for (size_t i = 0; i < num_outputs_; ++i)
     {
-        nvinfer1::Dims dims = engine_->getBindingDimensions(i + num_inputs_); // i + 1 to account for the input buffer
-        auto num_elements = getSizeByDim(dims);
-        std::vector<std::any> tensor_data;
-        switch (engine_->getBindingDataType(i + num_inputs_))
+        const int binding = i + num_inputs_;
+        const nvinfer1::Dims dims = context_->getBindingDimensions(binding);
+        auto& host_output = host_outputs_[i];
+        cudaMemcpy(host_output->data(), buffers_[binding], binding_bytes(binding), cudaMemcpyDeviceToHost);
+
+        std::vector<int64_t> out_shape(dims.d, dims.d + dims.nbDims);
+        switch (engine_->getBindingDataType(binding))
         {
             case nvinfer1::DataType::kFLOAT:
-            {
-                std::vector<float> output_data_float(num_elements);
-                cudaMemcpy(output_data_float.data(), buffers_[i + num_inputs_],  num_elements * sizeof(float), cudaMemcpyDeviceToHost);
-                tensor_data = std::vector<std::any>(output_data_float.begin(), output_data_float.end());
+                outputs.emplace_back(TensorType::Float32, std::move(out_shape), host_output->data(), host_output);
                 break;
-            }
             case nvinfer1::DataType::kINT32:
-            {
-                std::vector<int32_t> output_data_int(num_elements);
-                cudaMemcpy(output_data_int.data(), buffers_[i + num_inputs_],  num_elements * sizeof(int32_t), cudaMemcpyDeviceToHost);
-                tensor_data = std::vector<std::any>(output_data_int.begin(), output_data_int.end());
+                outputs.emplace_back(TensorType::Int32, std::move(out_shape), host_output->data(), host_output);
                 break;
-            }
 
             // Add more cases for other data types if needed
             default:
@@ -164,12 +193,7 @@ std::tuple<std::vector<std::vector<std::any>>, std::vector<std::vector<int64_t>>
                 std::exit(1);
                 break;
         }
-        outputs.emplace_back(std::move(tensor_data));
-        
-        const int64_t curr_batch = dims.d[0] == -1 ? 1 : dims.d[0];
-        const auto out_shape = std::vector<int64_t>{curr_batch, dims.d[1], dims.d[2], dims.d[3] };
-        output_shapes.emplace_back(out_shape);
     }
 
-    return std::make_tuple(std::move(outputs), std::move(output_shapes));
+    return outputs;
 }
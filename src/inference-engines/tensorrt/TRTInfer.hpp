@@ -3,6 +3,7 @@
 #include <NvInfer.h>  // for TensorRT API
 #include <cuda_runtime_api.h>  // for CUDA runtime API
 #include <fstream>
+#include <array>
 
 #include "Logger.hpp"
 
@@ -12,9 +13,17 @@ class TRTInfer : public InferenceInterface
         std::shared_ptr<nvinfer1::ICudaEngine> engine_{nullptr};
         nvinfer1::IExecutionContext* context_{nullptr};
         std::vector<void*> buffers_;
+        std::vector<std::shared_ptr<std::vector<uint8_t>>> host_outputs_;
         nvinfer1::IRuntime* runtime_{nullptr};
         size_t num_inputs_{0};
         size_t num_outputs_{0};
+        bool dynamic_batch_{false};
+        int max_batch_size_{1};
+        int batch_size_{1};                     // Batch the context dimensions are currently set for
+        std::vector<int32_t> orig_target_sizes_;
+
+        void set_batch_size(int batch_size);
+        size_t binding_bytes(int binding);
 
     public:
         TRTInfer(const std::string& model_path);
@@ -29,10 +38,13 @@ class TRTInfer : public InferenceInterface
 
         void infer();
 
-        std::tuple<std::vector<std::vector<std::any>>, std::vector<std::vector<int64_t>>> get_infer_results(const cv::Mat& input_blob) override;
+        std::vector<TensorView> get_infer_results(const cv::Mat& input_blob) override;
+        bool output_buffers_reused() const override { return true; }
+        size_t max_batch_size() const override { return static_cast<size_t>(max_batch_size_); }
 
         ~TRTInfer()
         {
+            shutdown_async();
             for (void* buffer : buffers_)
             {
                 cudaFree(buffer);
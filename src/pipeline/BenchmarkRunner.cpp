@@ -0,0 +1,193 @@
+#include "BenchmarkRunner.hpp"
+#include "JsonString.hpp"
+#include <sys/resource.h>
+
+namespace
+{
+    using Clock = std::chrono::steady_clock;
+
+    double elapsed_ms(Clock::time_point start, Clock::time_point end)
+    {
+        return std::chrono::duration<double, std::milli>(end - start).count();
+    }
+
+    // Nearest rank on sorted samples
+    double percentile(const std::vector<double>& sorted, double p)
+    {
+        const size_t rank = static_cast<size_t>(std::ceil(p / 100.0 * sorted.size()));
+        return sorted[std::min(std::max<size_t>(rank, 1), sorted.size()) - 1];
+    }
+
+    std::string summary_json(const LatencySummary& s)
+    {
+        return fmt::format("{{\"mean\":{:.4f},\"p50\":{:.4f},\"p90\":{:.4f},\"p99\":{:.4f},\"min\":{:.4f},\"max\":{:.4f}}}",
+            s.mean, s.p50, s.p90, s.p99, s.min, s.max);
+    }
+}
+
+
+LatencySummary LatencySummary::from(std::vector<double> samples_ms)
+{
+    LatencySummary summary;
+    if (samples_ms.empty())
+    {
+        return summary;
+    }
+    std::sort(samples_ms.begin(), samples_ms.end());
+    double sum = 0;
+    for (const double sample : samples_ms)
+    {
+        sum += sample;
+    }
+    summary.mean = sum / samples_ms.size();
+    summary.p50 = percentile(samples_ms, 50);
+    summary.p90 = percentile(samples_ms, 90);
+    summary.p99 = percentile(samples_ms, 99);
+    summary.min = samples_ms.front();
+    summary.max = samples_ms.back();
+    return summary;
+}
+
+
+void BenchmarkResult::log(spdlog::logger& logger) const
+{
+    logger.info("Benchmark: {} iterations of batch {} after {} warmup, {} distinct frames", iterations, batch_size, warmup, frames);
+    logger.info("Throughput {:.2f} images/s, {:.3f} s", throughput, elapsed_s);
+    const std::pair<const char*, const LatencySummary*> rows[] = {
+        {"latency", &latency}, {"preprocess", &preprocess}, {"inference", &inference}, {"postprocess", &postprocess}};
+    for (const auto& [name, s] : rows)
+    {
+        logger.info("{:<11} mean {:8.3f}  p50 {:8.3f}  p90 {:8.3f}  p99 {:8.3f}  min {:8.3f}  max {:8.3f} ms", name, s->mean, s->p50, s->p90, s->p99, s->min, s->max);
+    }
+    logger.info("Peak RSS {:.1f} MB", peak_rss_mb);
+}
+
+
+std::string BenchmarkResult::to_json(const BenchmarkInfo& info) const
+{
+    return fmt::format("{{\"detector\":\"{}\",\"backend\":\"{}\",\"weights\":\"{}\",\"input\":\"{}\","
+        "\"warmup\":{},\"iterations\":{},\"batch_size\":{},\"frames\":{},\"elapsed_s\":{:.4f},\"throughput\":{:.3f},"
+        "\"latency_ms\":{},\"stages_ms\":{{\"preprocess\":{},\"inference\":{},\"postprocess\":{}}},\"peak_rss_mb\":{:.1f}}}\n",
+        json_string(info.detector), json_string(info.backend), json_string(info.weights), json_string(info.input),
+        warmup, iterations, batch_size, frames, elapsed_s, throughput,
+        summary_json(latency), summary_json(preprocess), summary_json(inference), summary_json(postprocess), peak_rss_mb);
+}
+
+
+BenchmarkRunner::BenchmarkRunner(Detector& detector, InferenceInterface& engine, std::vector<cv::Mat> frames, size_t batch_size,
+    std::vector<cv::Size> frame_sizes) :
+    detector_{detector},
+    engine_{engine},
+    frames_{std::move(frames)},
+    frame_sizes_{std::move(frame_sizes)},
+    batch_size_{std::max<size_t>(batch_size, 1)}
+{
+    if (frame_sizes_.size() != frames_.size())
+    {
+        frame_sizes_.clear();
+        for (const cv::Mat& frame : frames_)
+        {
+            frame_sizes_.push_back(frame.size());
+        }
+    }
+}
+
+
+BenchmarkResult BenchmarkRunner::run(size_t warmup, size_t iterations)
+{
+    BenchmarkResult result;
+    result.warmup = warmup;
+    result.iterations = iterations;
+    result.batch_size = batch_size_;
+    result.frames = frames_.size();
+
+    std::vector<double> latency, preprocess, inference, postprocess;
+    latency.reserve(iterations);
+    preprocess.reserve(iterations);
+    inference.reserve(iterations);
+    postprocess.reserve(iterations);
+
+    size_t next_frame = 0;
+    Clock::time_point timed_start = Clock::now();
+    for (size_t i = 0; i < warmup + iterations; ++i)
+    {
+        if (i == warmup)
+        {
+            timed_start = Clock::now();
+        }
+
+        const auto start = Clock::now();
+        std::vector<std::vector<TensorView>> outputs;
+        std::vector<cv::Size> frame_sizes;
+        Clock::time_point preprocessed, inferred;
+        if (batch_size_ == 1)
+        {
+            const size_t k = next_frame++ % frames_.size();
+            cv::Mat& input_blob = engine_.get_input_blob();
+            detector_.preprocess_image(frames_[k], input_blob);
+            preprocessed = Clock::now();
+            outputs.push_back(engine_.get_infer_results(input_blob));
+            inferred = Clock::now();
+            frame_sizes.push_back(frame_sizes_[k]);
+        }
+        else
+        {
+            // Preprocess straight into the arena slices once the engine knows its input shape
+            std::vector<cv::Mat> slices = engine_.get_input_batch(batch_size_);
+            blobs_.resize(batch_size_);
+            for (size_t b = 0; b < batch_size_; ++b)
+            {
+                const size_t k = next_frame++ % frames_.size();
+                if (!slices.empty())
+                {
+                    blobs_[b] = slices[b];
+                }
+                detector_.preprocess_image(frames_[k], blobs_[b]);
+                frame_sizes.push_back(frame_sizes_[k]);
+            }
+            preprocessed = Clock::now();
+            outputs = engine_.get_infer_results_batch(blobs_);
+            inferred = Clock::now();
+        }
+        detections_.resize(outputs.size());
+        for (size_t b = 0; b < outputs.size(); ++b)
+        {
+            detector_.postprocess(outputs[b], frame_sizes[b], detections_[b]);
+        }
+        const auto end = Clock::now();
+
+        if (i >= warmup)
+        {
+            latency.push_back(elapsed_ms(start, end));
+            preprocess.push_back(elapsed_ms(start, preprocessed));
+            inference.push_back(elapsed_ms(preprocessed, inferred));
+            postprocess.push_back(elapsed_ms(inferred, end));
+        }
+    }
+
+    result.elapsed_s = std::chrono::duration<double>(Clock::now() - timed_start).count();
+    result.throughput = result.elapsed_s > 0 ? iterations * batch_size_ / result.elapsed_s : 0.0;
+    result.latency = LatencySummary::from(std::move(latency));
+    result.preprocess = LatencySummary::from(std::move(preprocess));
+    result.inference = LatencySummary::from(std::move(inference));
+    result.postprocess = LatencySummary::from(std::move(postprocess));
+    result.peak_rss_mb = read_peak_rss_mb();
+    return result;
+}
+
+
+cv::Mat synthetic_frame(const cv::Size& size)
+{
+    cv::Mat frame(size, CV_8UC3);
+    cv::randu(frame, cv::Scalar::all(0), cv::Scalar::all(255));
+    return frame;
+}
+
+
+double read_peak_rss_mb()
+{
+    rusage usage{};
+    getrusage(RUSAGE_SELF, &usage);
+    // Kilobytes on Linux
+    return usage.ru_maxrss / 1024.0;
+}
@@ -0,0 +1,71 @@
+#pragma once
+#include "Detector.hpp"
+#include "InferenceInterface.hpp"
+
+// Latency distribution of one measured quantity, in ms
+struct LatencySummary
+{
+    double mean{0};
+    double p50{0};
+    double p90{0};
+    double p99{0};
+    double min{0};
+    double max{0};
+
+    static LatencySummary from(std::vector<double> samples_ms);
+};
+
+// What was measured, copied to the JSON report so runs of different backends can be compared
+struct BenchmarkInfo
+{
+    std::string detector;
+    std::string backend;
+    std::string weights;
+    std::string input;
+};
+
+struct BenchmarkResult
+{
+    size_t warmup{0};
+    size_t iterations{0};
+    size_t batch_size{1};
+    size_t frames{0};           // Distinct in-memory frames cycled through
+    double elapsed_s{0};        // Timed iterations only
+    double throughput{0};       // Images per second
+    LatencySummary latency;     // Per iteration (one batch), preprocess to postprocess
+    LatencySummary preprocess;
+    LatencySummary inference;
+    LatencySummary postprocess;
+    double peak_rss_mb{0};
+
+    void log(spdlog::logger& logger) const;
+    std::string to_json(const BenchmarkInfo& info) const;
+};
+
+// Runs the detector + engine path on frames already decoded into memory, so decode and capture
+// don't add noise: warmup iterations first, then timed ones, batch_size frames per iteration.
+// frame_sizes, when given, are the sizes postprocess maps the boxes to (full resolution of frames
+// decoded at a reduced scale), one per frame; by default the frames' own sizes.
+class BenchmarkRunner
+{
+public:
+    BenchmarkRunner(Detector& detector, InferenceInterface& engine, std::vector<cv::Mat> frames, size_t batch_size = 1,
+        std::vector<cv::Size> frame_sizes = {});
+
+    BenchmarkResult run(size_t warmup, size_t iterations);
+
+private:
+    Detector& detector_;
+    InferenceInterface& engine_;
+    std::vector<cv::Mat> frames_;
+    std::vector<cv::Size> frame_sizes_;
+    size_t batch_size_;
+    std::vector<cv::Mat> blobs_;
+    std::vector<std::vector<Detection>> detections_;
+};
+
+// Random content frame, preprocessing and inference cost don't depend on the pixels
+cv::Mat synthetic_frame(const cv::Size& size);
+
+// Peak resident set size of the process so far
+double read_peak_rss_mb();
@@ -0,0 +1,224 @@
+#include "DetectionSink.hpp"
+#include "JsonString.hpp"
+
+std::shared_ptr<spdlog::logger> DetectionSink::logger_;
+
+namespace
+{
+    constexpr size_t io_buffer_size = 1 << 20;
+}
+
+
+std::FILE* DetectionSink::open_output(const std::string& path, const char* mode)
+{
+    std::FILE* file = std::fopen(path.c_str(), mode);
+    if (!file)
+    {
+        logger_->error("Can't open detection output {}", path);
+        std::exit(1);
+    }
+    return file;
+}
+
+
+DetectionSink::DetectionSink(size_t producers, size_t capacity)
+{
+    for (size_t i = 0; i < std::max<size_t>(producers, 1); ++i)
+    {
+        queues_.push_back(std::make_unique<SpscQueue<DetectionRecord>>(capacity));
+    }
+}
+
+
+void DetectionSink::start()
+{
+    writer_ = std::thread(&DetectionSink::writer_loop, this);
+}
+
+
+bool DetectionSink::write(size_t producer, uint32_t stream, uint64_t frame, const std::vector<Detection>& detections, const std::string& source)
+{
+    DetectionRecord record;
+    record.stream = stream;
+    record.frame = frame;
+    record.timestamp_us = std::chrono::duration_cast<std::chrono::microseconds>(std::chrono::system_clock::now().time_since_epoch()).count();
+    record.detections = detections;
+    record.source = source;
+    SpscQueue<DetectionRecord>& queue = *queues_[producer];
+    // A failed push leaves the record in place, it can be retried
+    Backoff backoff;
+    while (!queue.try_push(std::move(record)))
+    {
+        if (!blocking_)
+        {
+            dropped_.fetch_add(1, std::memory_order_relaxed);
+            return false;
+        }
+        backoff.wait();
+    }
+    return true;
+}
+
+
+void DetectionSink::stop()
+{
+    if (!writer_.joinable())
+    {
+        return;
+    }
+    stop_ = true;
+    writer_.join();
+    if (dropped() > 0 && logger_)
+    {
+        logger_->warn("Detection sink dropped {} records, the writer couldn't keep up", dropped());
+    }
+}
+
+
+void DetectionSink::writer_loop()
+{
+    DetectionRecord record;
+    Backoff backoff;
+    for (;;)
+    {
+        // Read the flag first, records pushed before it was set are still drained below
+        const bool stopping = stop_;
+        bool progress = false;
+        for (auto& queue : queues_)
+        {
+            while (queue->try_pop(record))
+            {
+                write_record(record);
+                written_.fetch_add(1, std::memory_order_relaxed);
+                progress = true;
+            }
+        }
+
+        if (progress)
+        {
+            backoff.reset();
+        }
+        else if (stopping)
+        {
+            break;
+        }
+        else
+        {
+            // Idle, hand the buffered records to the OS while waiting
+            flush();
+            backoff.wait();
+        }
+    }
+    flush();
+}
+
+
+JsonLinesSink::JsonLinesSink(const std::string& path, const std::vector<std::string>& labels, size_t producers) :
+    DetectionSink{producers},
+    file_{path.empty() ? stdout : open_output(path, "w")},
+    owns_file_{!path.empty()},
+    labels_{labels},
+    buffer_(io_buffer_size)
+{
+    // stdout may already have been written to, it keeps its own buffering
+    if (owns_file_)
+    {
+        std::setvbuf(file_, buffer_.data(), _IOFBF, buffer_.size());
+    }
+    start();
+}
+
+
+JsonLinesSink::~JsonLinesSink()
+{
+    stop();
+    if (owns_file_)
+    {
+        std::fclose(file_);
+    }
+}
+
+
+void JsonLinesSink::write_record(const DetectionRecord& record)
+{
+    line_ = fmt::format("{{\"stream\":{},\"frame\":{},", record.stream, record.frame);
+    if (!record.source.empty())
+    {
+        line_ += "\"source\":\"";
+        append_json_string(line_, record.source);
+        line_ += "\",";
+    }
+    fmt::format_to(std::back_inserter(line_), "\"timestamp_us\":{},\"detections\":[", record.timestamp_us);
+    for (size_t i = 0; i < record.detections.size(); ++i)
+    {
+        const Detection& d = record.detections[i];
+        const std::string& label = d.label >= 0 && static_cast<size_t>(d.label) < labels_.size() ? labels_[d.label] : std::string();
+        line_ += i > 0 ? ",{\"label\":\"" : "{\"label\":\"";
+        append_json_string(line_, label);
+        fmt::format_to(std::back_inserter(line_), "\",\"class_id\":{},\"score\":{:.4f},\"bbox\":[{},{},{},{}]}}",
+            d.label, d.score, d.bbox.x, d.bbox.y, d.bbox.width, d.bbox.height);
+    }
+    line_ += "]}\n";
+    std::fwrite(line_.data(), 1, line_.size(), file_);
+}
+
+
+void JsonLinesSink::flush()
+{
+    std::fflush(file_);
+}
+
+
+BinarySink::BinarySink(const std::string& path, size_t producers) :
+    DetectionSink{producers},
+    file_{open_output(path, "wb")},
+    buffer_(io_buffer_size)
+{
+    std::setvbuf(file_, buffer_.data(), _IOFBF, buffer_.size());
+    start();
+}
+
+
+BinarySink::~BinarySink()
+{
+    stop();
+    std::fclose(file_);
+}
+
+
+void BinarySink::write_record(const DetectionRecord& record)
+{
+    const uint32_t count = static_cast<uint32_t>(record.detections.size());
+    std::fwrite(&record.stream, sizeof(record.stream), 1, file_);
+    std::fwrite(&record.frame, sizeof(record.frame), 1, file_);
+    std::fwrite(&record.timestamp_us, sizeof(record.timestamp_us), 1, file_);
+    std::fwrite(&count, sizeof(count), 1, file_);
+    for (const Detection& d : record.detections)
+    {
+        const int32_t box[] = { d.bbox.x, d.bbox.y, d.bbox.width, d.bbox.height };
+        const int32_t class_id = d.label;
+        std::fwrite(&class_id, sizeof(class_id), 1, file_);
+        std::fwrite(&d.score, sizeof(d.score), 1, file_);
+        std::fwrite(box, sizeof(box), 1, file_);
+    }
+}
+
+
+void BinarySink::flush()
+{
+    std::fflush(file_);
+}
+
+
+std::unique_ptr<DetectionSink> create_detection_sink(const std::string& target, const std::vector<std::string>& labels, size_t producers)
+{
+    if (target == "stdout")
+    {
+        return std::make_unique<JsonLinesSink>("", labels, producers);
+    }
+    if (std::filesystem::path(target).extension() == ".bin")
+    {
+        return std::make_unique<BinarySink>(target, producers);
+    }
+    return std::make_unique<JsonLinesSink>(target, labels, producers);
+}
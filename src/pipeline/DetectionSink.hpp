@@ -0,0 +1,111 @@
+#pragma once
+#include "Detector.hpp"
+#include "SpscQueue.hpp"
+#include <cstdio>
+
+// Detections of one frame, as handed to a sink
+struct DetectionRecord
+{
+    uint32_t stream{0};
+    uint64_t frame{0};
+    int64_t timestamp_us{0};    // Wall clock time the record was written
+    std::vector<Detection> detections;
+    std::string source;         // Image path in batch image mode, empty for video frames
+};
+
+// Asynchronous detection output: write() only moves the record into a lock-free queue (one per
+// producer thread), a background thread drains the queues and formats the records through buffered
+// I/O. By default write() never blocks and records are dropped, and counted, when a queue is full;
+// a blocking sink waits for the writer instead, for offline runs where every record must be kept.
+// Implementations call start() at the end of their constructor and stop() in their destructor,
+// the writer thread only runs while the whole object exists.
+class DetectionSink
+{
+public:
+    DetectionSink(size_t producers = 1, size_t capacity = 1024);
+    virtual ~DetectionSink() = default;
+
+    DetectionSink(const DetectionSink&) = delete;
+    DetectionSink& operator=(const DetectionSink&) = delete;
+
+    // Thread safe as long as every producer index is used by a single thread
+    bool write(size_t producer, uint32_t stream, uint64_t frame, const std::vector<Detection>& detections, const std::string& source = "");
+
+    // Set before the producers start writing
+    void set_blocking(bool blocking) { blocking_ = blocking; }
+    bool blocking() const { return blocking_; }
+
+    uint64_t written() const { return written_.load(std::memory_order_relaxed); }
+    uint64_t dropped() const { return dropped_.load(std::memory_order_relaxed); }
+
+    static void SetLogger(const std::shared_ptr<spdlog::logger>& logger)
+    {
+        logger_ = logger;
+    }
+
+protected:
+    // Writer thread only
+    virtual void write_record(const DetectionRecord& record) = 0;
+    virtual void flush() = 0;
+
+    // Exits when the file can't be opened
+    static std::FILE* open_output(const std::string& path, const char* mode);
+
+    void start();
+    // Drains the queues and joins the writer thread
+    void stop();
+
+    static std::shared_ptr<spdlog::logger> logger_;
+
+private:
+    void writer_loop();
+
+    std::vector<std::unique_ptr<SpscQueue<DetectionRecord>>> queues_;
+    std::atomic<bool> stop_{false};
+    bool blocking_{false};
+    std::atomic<uint64_t> written_{0};
+    std::atomic<uint64_t> dropped_{0};
+    std::thread writer_;
+};
+
+// {"stream":0,"frame":12,"timestamp_us":...,"detections":[{"label":"person","class_id":0,"score":0.91,"bbox":[x,y,w,h]}]} per line,
+// records with a source also get "source":"<path>" after the frame
+class JsonLinesSink : public DetectionSink
+{
+public:
+    // An empty path writes to stdout
+    JsonLinesSink(const std::string& path, const std::vector<std::string>& labels, size_t producers = 1);
+    ~JsonLinesSink() override;
+
+protected:
+    void write_record(const DetectionRecord& record) override;
+    void flush() override;
+
+private:
+    std::FILE* file_;
+    bool owns_file_;
+    std::vector<std::string> labels_;
+    std::vector<char> buffer_;
+    std::string line_;
+};
+
+// Native endian records: stream (u32), frame (u64), timestamp_us (i64), count (u32), then count
+// times class_id (i32), score (f32), x, y, width, height (i32). The source isn't written, images are
+// identified by the frame (their position in the image list)
+class BinarySink : public DetectionSink
+{
+public:
+    BinarySink(const std::string& path, size_t producers = 1);
+    ~BinarySink() override;
+
+protected:
+    void write_record(const DetectionRecord& record) override;
+    void flush() override;
+
+private:
+    std::FILE* file_;
+    std::vector<char> buffer_;
+};
+
+// "stdout", a .bin file (binary records) or any other file (JSON lines)
+std::unique_ptr<DetectionSink> create_detection_sink(const std::string& target, const std::vector<std::string>& labels, size_t producers = 1);
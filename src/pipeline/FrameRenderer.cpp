@@ -0,0 +1,164 @@
+#include "FrameRenderer.hpp"
+#ifdef USE_GSTREAMER
+#include "GStreamerOpenCV.hpp"
+#endif
+
+std::shared_ptr<spdlog::logger> FrameRenderer::logger_;
+
+
+// Every frame in flight can sit in the recycled queue at once, so recycling never waits
+FrameRenderer::FrameRenderer(const std::vector<std::string>& labels, bool display, const std::string& record_path, double record_fps, size_t depth) :
+    display_{display},
+    record_path_{record_path},
+    record_fps_{record_fps},
+    sprites_{labels},
+    render_queue_{std::max<size_t>(depth, 1)},
+    encode_queue_{std::max<size_t>(depth, 1)},
+    recycled_{2 * std::max<size_t>(depth, 1) + 1}
+{
+    render_thread_ = std::thread(&FrameRenderer::render_loop, this);
+    if (!record_path_.empty())
+    {
+        encode_thread_ = std::thread(&FrameRenderer::encode_loop, this);
+    }
+}
+
+
+FrameRenderer::~FrameRenderer()
+{
+    done_ = true;
+    render_thread_.join();
+    if (encode_thread_.joinable())
+    {
+        encode_thread_.join();
+    }
+    if (writer_.isOpened())
+    {
+        writer_.release();
+    }
+}
+
+
+void FrameRenderer::submit(cv::Mat& frame, const std::vector<Detection>& detections)
+{
+    RenderJob job;
+    job.frame = frame;
+    job.detections = detections;
+    // The producer keeps reading into a buffer of the same size, so swapping costs no allocation after warmup
+    cv::Mat spare;
+    frame = recycled_.try_pop(spare) ? spare : cv::Mat();
+    Backoff backoff;
+    while (!render_queue_.try_push(std::move(job)))
+    {
+        backoff.wait();
+    }
+}
+
+
+void FrameRenderer::recycle(cv::Mat&& frame)
+{
+#ifdef USE_GSTREAMER
+    // Zero copy capture frames point into a GStreamer sample. Queued here they would keep the sample,
+    // and the capture copies frames once too many are held, so give it back right away
+    if (GStreamerOpenCV::holdsSample(frame))
+    {
+        frame.release();
+        return;
+    }
+#endif
+    // Full only when the producer stopped taking buffers back, let this one go
+    recycled_.try_push(std::move(frame));
+}
+
+
+void FrameRenderer::render_loop()
+{
+    Trace::set_thread_name("render");
+    RenderJob job;
+    Backoff backoff;
+    auto last_frame = std::chrono::steady_clock::now();
+    for (;;)
+    {
+        if (!render_queue_.try_pop(job))
+        {
+            if (done_)
+            {
+                break;
+            }
+            backoff.wait();
+            continue;
+        }
+        backoff.reset();
+
+        // Frames reach this thread at the pipeline throughput, measure it between consecutive frames
+        const auto start = std::chrono::steady_clock::now();
+        AllocationScope allocations(Stage::Render);
+        const double interval = std::chrono::duration<double>(start - last_frame).count();
+        last_frame = start;
+        const double fps = interval > 0 ? 1.0 / interval : 0.0;
+        char fpsText[32];
+        std::snprintf(fpsText, sizeof(fpsText), "FPS: %f", fps);
+        cv::putText(job.frame, fpsText, cv::Point(10, 30), cv::FONT_HERSHEY_SIMPLEX, 1, cv::Scalar(0, 255, 0), 2);
+        for (const auto& d : job.detections)
+        {
+            cv::rectangle(job.frame, d.bbox, cv::Scalar(255, 0, 0), 3);
+            sprites_.draw(job.frame, d.label, d.score, d.bbox.x, d.bbox.y);
+        }
+
+        if (display_)
+        {
+            cv::imshow("opencv feed", job.frame);
+            char key = cv::waitKey(1);
+            if (key == 27 || key == 'q')
+            {
+                stop_requested_ = true;
+            }
+        }
+        StageTimers::record(Stage::Render, start, std::chrono::steady_clock::now());
+
+        if (encode_thread_.joinable())
+        {
+            push_wait(encode_queue_, job.frame);
+            job.frame.release();
+        }
+        else
+        {
+            recycle(std::move(job.frame));
+        }
+    }
+    render_done_ = true;
+}
+
+
+void FrameRenderer::encode_loop()
+{
+    Trace::set_thread_name("encode");
+    cv::Mat frame;
+    Backoff backoff;
+    for (;;)
+    {
+        if (!encode_queue_.try_pop(frame))
+        {
+            if (render_done_)
+            {
+                break;
+            }
+            backoff.wait();
+            continue;
+        }
+        backoff.reset();
+
+        // Opened on the first frame, its size isn't known before
+        if (!writer_.isOpened())
+        {
+            if (!writer_.open(record_path_, cv::VideoWriter::fourcc('m', 'p', '4', 'v'), record_fps_, frame.size()))
+            {
+                logger_->error("Can't open video output {}", record_path_);
+                std::exit(1);
+            }
+            logger_->info("Recording to {}", record_path_);
+        }
+        writer_.write(frame);
+        recycle(std::move(frame));
+    }
+}
@@ -0,0 +1,61 @@
+#pragma once
+#include "Detector.hpp"
+#include "LabelSpriteCache.hpp"
+#include "SpscQueue.hpp"
+#include "StageTimers.hpp"
+
+// Annotation and output off the inference path: submitted frames are annotated (boxes, cached
+// label sprites, FPS) on a render thread which also owns the display window, and recorded by an
+// encoder thread through cv::VideoWriter. Frame buffers are swapped rather than copied, the
+// producer gets back a buffer of a frame already shown or written.
+class FrameRenderer
+{
+public:
+    // record_path empty: no recording. display false: no window (headless recording).
+    FrameRenderer(const std::vector<std::string>& labels, bool display, const std::string& record_path = "", double record_fps = 30.0, size_t depth = 4);
+    ~FrameRenderer();
+
+    FrameRenderer(const FrameRenderer&) = delete;
+    FrameRenderer& operator=(const FrameRenderer&) = delete;
+
+    // Takes the frame content, leaving a recycled buffer in its place. Waits only when the render
+    // thread is a whole queue behind. Single producer thread.
+    void submit(cv::Mat& frame, const std::vector<Detection>& detections);
+
+    // Esc or q pressed in the display window
+    bool stop_requested() const { return stop_requested_; }
+
+    static void SetLogger(const std::shared_ptr<spdlog::logger>& logger)
+    {
+        logger_ = logger;
+    }
+
+private:
+    struct RenderJob
+    {
+        cv::Mat frame;
+        std::vector<Detection> detections;
+    };
+
+    void render_loop();
+    void encode_loop();
+    void recycle(cv::Mat&& frame);
+
+    bool display_;
+    std::string record_path_;
+    double record_fps_;
+    LabelSpriteCache sprites_;
+    cv::VideoWriter writer_;
+
+    // Producer -> render thread -> encoder thread (when recording) -> producer
+    SpscQueue<RenderJob> render_queue_;
+    SpscQueue<cv::Mat> encode_queue_;
+    SpscQueue<cv::Mat> recycled_;
+    std::atomic<bool> done_{false};
+    std::atomic<bool> render_done_{false};
+    std::atomic<bool> stop_requested_{false};
+    std::thread render_thread_;
+    std::thread encode_thread_;
+
+    static std::shared_ptr<spdlog::logger> logger_;
+};
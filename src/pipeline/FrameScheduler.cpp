@@ -0,0 +1,81 @@
+#include "FrameScheduler.hpp"
+
+FrameScheduler::FrameScheduler(std::chrono::microseconds latency_budget) :
+    budget_ns_{std::chrono::duration_cast<std::chrono::nanoseconds>(latency_budget).count()}
+{
+}
+
+
+// Single writer per average, the load/store pair doesn't need to be a read-modify-write
+void FrameScheduler::update(std::atomic<int64_t>& average, std::chrono::nanoseconds sample)
+{
+    const int64_t previous = average.load(std::memory_order_relaxed);
+    average.store(previous == 0 ? sample.count() : previous + (sample.count() - previous) / 8, std::memory_order_relaxed);
+}
+
+
+FrameDecision FrameScheduler::decide(Clock::time_point capture_time)
+{
+    if (!enabled())
+    {
+        return FrameDecision::Infer;
+    }
+
+    // Frames already waiting for the engine complete one interval apart, then this one goes through
+    // every stage. An idle engine always gets the frame: it keeps the estimates measured, so one slow
+    // spell can't freeze the detections, and covers the start when nothing is known yet.
+    const int64_t inference = inference_ns_.load(std::memory_order_relaxed);
+    const int64_t pending = pending_inference_.load(std::memory_order_relaxed);
+    const int64_t waited = std::chrono::duration_cast<std::chrono::nanoseconds>(Clock::now() - capture_time).count();
+    const int64_t predicted = waited + preprocess_ns_.load(std::memory_order_relaxed) +
+        pending * inference_interval_ns_.load(std::memory_order_relaxed) + inference + postprocess_ns_.load(std::memory_order_relaxed);
+    if (pending == 0 || (inference > 0 && predicted <= budget_ns_))
+    {
+        pending_inference_.fetch_add(1, std::memory_order_relaxed);
+        return FrameDecision::Infer;
+    }
+    return FrameDecision::Reuse;
+}
+
+
+bool FrameScheduler::expired(Clock::time_point capture_time) const
+{
+    return enabled() && Clock::now() - capture_time > std::chrono::nanoseconds(budget_ns_);
+}
+
+
+void FrameScheduler::record_inference(std::chrono::nanoseconds duration)
+{
+    // Back to back completions are closer than the latency when requests overlap, an idle engine
+    // leaves a longer gap, so the interval sample never exceeds the latency
+    const Clock::time_point now = Clock::now();
+    const bool first = last_inference_ == Clock::time_point{};
+    update(inference_interval_ns_, first ? duration : std::min(duration, std::chrono::duration_cast<std::chrono::nanoseconds>(now - last_inference_)));
+    last_inference_ = now;
+    update(inference_ns_, duration);
+    if (enabled())
+    {
+        pending_inference_.fetch_sub(1, std::memory_order_relaxed);
+    }
+}
+
+
+void FrameScheduler::record_done(Clock::time_point capture_time, FrameDecision decision)
+{
+    switch (decision)
+    {
+        case FrameDecision::Infer:
+            processed_.fetch_add(1, std::memory_order_relaxed);
+            break;
+        case FrameDecision::Reuse:
+            reused_.fetch_add(1, std::memory_order_relaxed);
+            break;
+        case FrameDecision::Skip:
+            skipped_.fetch_add(1, std::memory_order_relaxed);
+            return;
+    }
+    if (expired(capture_time))
+    {
+        late_.fetch_add(1, std::memory_order_relaxed);
+    }
+}
@@ -0,0 +1,64 @@
+#pragma once
+#include "common.hpp"
+#include <atomic>
+#include <chrono>
+
+// What the pipeline does with a captured frame
+enum class FrameDecision
+{
+    Infer,      // Full preprocess, inference and postprocess
+    Reuse,      // Shown with the detections of the last inferred frame
+    Skip        // Dropped, already older than the latency budget
+};
+
+// Keeps the capture to render latency of live sources under a budget. Stage latencies and the interval
+// between inference completions (below the latency when the engine runs requests concurrently) are
+// tracked as moving averages, a frame is only sent to inference when the engine is idle or when the
+// frames already waiting for it plus its own processing fit in the budget, the others reuse the last
+// detections.
+// A zero budget disables scheduling, every frame is inferred.
+// Stage reports come from one thread each, decisions from the capture thread.
+class FrameScheduler
+{
+public:
+    using Clock = std::chrono::steady_clock;
+
+    explicit FrameScheduler(std::chrono::microseconds latency_budget = std::chrono::microseconds(0));
+
+    bool enabled() const { return budget_ns_ > 0; }
+
+    // Called right after capture
+    FrameDecision decide(Clock::time_point capture_time);
+    // A frame whose inference was planned but that left the budget while waiting, before preprocessing
+    bool expired(Clock::time_point capture_time) const;
+
+    void record_preprocess(std::chrono::nanoseconds duration) { update(preprocess_ns_, duration); }
+    // One call per inferred frame, with the per frame share of a batched run
+    void record_inference(std::chrono::nanoseconds duration);
+    // Planned inference dropped before running (expired frame)
+    void cancel_inference() { pending_inference_.fetch_sub(1, std::memory_order_relaxed); }
+    void record_postprocess(std::chrono::nanoseconds duration) { update(postprocess_ns_, duration); }
+    // Called when the frame is rendered, counts the late ones
+    void record_done(Clock::time_point capture_time, FrameDecision decision);
+
+    uint64_t processed() const { return processed_.load(std::memory_order_relaxed); }
+    uint64_t reused() const { return reused_.load(std::memory_order_relaxed); }
+    uint64_t skipped() const { return skipped_.load(std::memory_order_relaxed); }
+    uint64_t late() const { return late_.load(std::memory_order_relaxed); }
+
+private:
+    static void update(std::atomic<int64_t>& average, std::chrono::nanoseconds sample);
+
+    int64_t budget_ns_;
+    std::atomic<int64_t> preprocess_ns_{0};
+    std::atomic<int64_t> inference_ns_{0};
+    std::atomic<int64_t> inference_interval_ns_{0};
+    Clock::time_point last_inference_;
+    std::atomic<int64_t> postprocess_ns_{0};
+    std::atomic<int64_t> pending_inference_{0};     // Frames decided Infer whose inference hasn't finished
+
+    std::atomic<uint64_t> processed_{0};
+    std::atomic<uint64_t> reused_{0};
+    std::atomic<uint64_t> skipped_{0};
+    std::atomic<uint64_t> late_{0};
+};
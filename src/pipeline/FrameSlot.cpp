@@ -0,0 +1,26 @@
+#include "FrameSlot.hpp"
+#include <cstring>
+
+void keep_outputs(const InferenceInterface& engine, std::vector<TensorView>&& outputs, FrameSlot& slot)
+{
+    if (!engine.output_buffers_reused())
+    {
+        slot.outputs = std::move(outputs);
+        return;
+    }
+
+    slot.output_copies.resize(outputs.size());
+    slot.outputs.clear();
+    for (size_t i = 0; i < outputs.size(); ++i)
+    {
+        const TensorView& view = outputs[i];
+        if (!view.is_contiguous())
+        {
+            throw std::runtime_error("keep_outputs: can't copy a non contiguous output tensor");
+        }
+        std::vector<uint8_t>& copy = slot.output_copies[i];
+        copy.resize(view.numel() * view.element_size());
+        std::memcpy(copy.data(), view.raw_data(), copy.size());
+        slot.outputs.emplace_back(view.type(), view.shape(), copy.data());
+    }
+}
@@ -0,0 +1,26 @@
+#pragma once
+#include "common.hpp"
+#include "Detector.hpp"
+#include "InferenceInterface.hpp"
+#include "FrameScheduler.hpp"
+#include "StageTimers.hpp"
+
+// A frame and everything computed from it while it travels through a pipeline,
+// slots are preallocated and recycled so buffers are reused from frame to frame
+struct FrameSlot
+{
+    uint64_t index{0};
+    FrameScheduler::Clock::time_point capture_time;
+    FrameDecision decision{FrameDecision::Infer};
+    FrameScheduler::Clock::time_point inference_start;
+    cv::Mat frame;
+    cv::Size frame_size;                            // Full resolution size when frame is a reduced decode
+    cv::Mat blob;                                   // Per slot input, the engine arena may be busy with another frame
+    std::vector<TensorView> outputs;
+    std::vector<std::vector<uint8_t>> output_copies; // Backing storage when the engine reuses its output buffers
+    std::vector<Detection> detections;
+};
+
+// Keeps the outputs of the slot's inference valid until its postprocess: views whose buffers the
+// engine reuses are copied into the slot storage (kept across frames), the others own their data
+void keep_outputs(const InferenceInterface& engine, std::vector<TensorView>&& outputs, FrameSlot& slot);
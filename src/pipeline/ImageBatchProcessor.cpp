@@ -0,0 +1,217 @@
+#include "ImageBatchProcessor.hpp"
+#include "ImageDecode.hpp"
+
+std::shared_ptr<spdlog::logger> ImageBatchProcessor::logger_;
+
+namespace
+{
+    // Annotated output only needs to be looked at, favour encoding speed over size
+    const std::vector<int> jpeg_params = {cv::IMWRITE_JPEG_QUALITY, 85};
+
+    bool has_image_extension(const std::filesystem::path& path)
+    {
+        std::string extension = path.extension().string();
+        std::transform(extension.begin(), extension.end(), extension.begin(), [](unsigned char c) { return std::tolower(c); });
+        return extension == ".jpg" || extension == ".jpeg" || extension == ".png" || extension == ".bmp" ||
+            extension == ".tif" || extension == ".tiff" || extension == ".webp";
+    }
+
+    bool is_list_file(const std::string& source)
+    {
+        const std::string extension = std::filesystem::path(source).extension().string();
+        return extension == ".txt" || extension == ".lst";
+    }
+
+    size_t worker_count(size_t workers)
+    {
+        return workers > 0 ? workers : std::max(std::thread::hardware_concurrency(), 1u);
+    }
+}
+
+
+bool is_image_batch_source(const std::string& source)
+{
+    return std::filesystem::is_directory(source) || source.find_first_of("*?") != std::string::npos || is_list_file(source);
+}
+
+
+std::vector<std::string> list_images(const std::string& source)
+{
+    std::vector<std::string> images;
+    if (std::filesystem::is_directory(source))
+    {
+        for (const auto& entry : std::filesystem::recursive_directory_iterator(source))
+        {
+            if (entry.is_regular_file() && has_image_extension(entry.path()))
+            {
+                images.push_back(entry.path().string());
+            }
+        }
+        std::sort(images.begin(), images.end());
+    }
+    else if (is_list_file(source))
+    {
+        std::ifstream list(source);
+        std::string line;
+        while (std::getline(list, line))
+        {
+            if (!line.empty() && line.back() == '\r')
+            {
+                line.pop_back();
+            }
+            if (!line.empty())
+            {
+                images.push_back(line);
+            }
+        }
+    }
+    else
+    {
+        cv::glob(source, images, false);
+        std::sort(images.begin(), images.end());
+    }
+    return images;
+}
+
+
+ImageBatchProcessor::Worker::Worker(std::unique_ptr<Detector> detector, const std::vector<std::string>& labels) :
+    detector{std::move(detector)},
+    label_sprites{labels}
+{
+}
+
+
+ImageBatchProcessor::ImageBatchProcessor(
+    std::vector<std::string> images,
+    const DetectorFactory& make_detector,
+    InferenceInterface& engine,
+    DetectionSink* sink,
+    const std::vector<std::string>& labels,
+    const std::string& annotate_dir,
+    size_t workers,
+    size_t max_batch,
+    std::chrono::microseconds batch_timeout,
+    size_t depth) :
+    images_{std::move(images)},
+    batcher_{engine, worker_count(workers), max_batch, batch_timeout, depth},
+    sink_{sink},
+    annotate_dir_{annotate_dir}
+{
+    // Offline run, the workers wait for the writer rather than losing records
+    if (sink_)
+    {
+        sink_->set_blocking(true);
+    }
+    for (size_t i = 0; i < batcher_.producers(); ++i)
+    {
+        workers_.emplace_back(std::make_unique<Worker>(make_detector(), labels));
+    }
+    if (!annotate_dir_.empty())
+    {
+        std::filesystem::create_directories(annotate_dir_);
+    }
+}
+
+
+void ImageBatchProcessor::run()
+{
+    const auto start = std::chrono::steady_clock::now();
+    std::vector<std::thread> threads;
+    for (size_t i = 0; i < workers_.size(); ++i)
+    {
+        threads.emplace_back(&ImageBatchProcessor::worker_loop, this, i);
+    }
+    std::thread batcher(&SlotBatcher::run_batcher, &batcher_, [this, start] { log_stats(start); });
+
+    for (auto& thread : threads)
+    {
+        thread.join();
+    }
+    batcher.join();
+    log_stats(start);
+}
+
+
+// Decode and preprocess the next images into free slots while the batcher holds the others,
+// finish them as they come back
+void ImageBatchProcessor::worker_loop(size_t index)
+{
+    Trace::set_thread_name(fmt::format("worker {}", index));
+    batcher_.run_producer(index,
+        [this, index](FrameSlot& slot) { return decode_next_image(index, slot); },
+        [this, index](FrameSlot& slot) { finish_image(index, slot); });
+}
+
+
+SlotBatcher::Fill ImageBatchProcessor::decode_next_image(size_t index, FrameSlot& slot)
+{
+    const size_t image = next_image_.fetch_add(1, std::memory_order_relaxed);
+    if (image >= images_.size())
+    {
+        return SlotBatcher::Fill::Ended;
+    }
+    Worker& worker = *workers_[index];
+    {
+        ScopedStageTimer timer(Stage::Capture);
+        slot.frame = decode_image(images_[image], worker.detector->network_size(), slot.frame_size);
+    }
+    if (slot.frame.empty())
+    {
+        logger_->warn("Can't decode image {}", images_[image]);
+        failed_.fetch_add(1, std::memory_order_relaxed);
+        return SlotBatcher::Fill::Skipped;
+    }
+    slot.index = image;
+    {
+        ScopedStageTimer timer(Stage::Preprocess);
+        worker.detector->preprocess_image(slot.frame, slot.blob);
+    }
+    return SlotBatcher::Fill::Ready;
+}
+
+
+void ImageBatchProcessor::finish_image(size_t index, FrameSlot& slot)
+{
+    Worker& worker = *workers_[index];
+    {
+        ScopedStageTimer timer(Stage::Postprocess);
+        worker.detector->postprocess(slot.outputs, slot.frame_size, slot.detections);
+    }
+    slot.outputs.clear();
+    const std::string& path = images_[slot.index];
+    if (sink_)
+    {
+        sink_->write(index, 0, slot.index, slot.detections, path);
+    }
+
+    if (!annotate_dir_.empty())
+    {
+        // Drawn on the decoded image, at the reduced resolution
+        const double scale = static_cast<double>(slot.frame.cols) / slot.frame_size.width;
+        for (const auto& d : slot.detections)
+        {
+            const cv::Rect box(cvRound(d.bbox.x * scale), cvRound(d.bbox.y * scale), cvRound(d.bbox.width * scale), cvRound(d.bbox.height * scale));
+            cv::rectangle(slot.frame, box, cv::Scalar(255, 0, 0), 3);
+            worker.label_sprites.draw(slot.frame, d.label, d.score, box.x, box.y);
+        }
+        // Prefixed with the list position, images of different directories may share a name
+        const std::filesystem::path output = std::filesystem::path(annotate_dir_) /
+            fmt::format("{:08}_{}.jpg", slot.index, std::filesystem::path(path).stem().string());
+        if (!cv::imwrite(output.string(), slot.frame, jpeg_params))
+        {
+            logger_->warn("Can't write annotated image {}", output.string());
+        }
+    }
+    processed_.fetch_add(1, std::memory_order_relaxed);
+}
+
+
+void ImageBatchProcessor::log_stats(std::chrono::steady_clock::time_point start) const
+{
+    const double elapsed = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+    const uint64_t images = processed();
+    logger_->info("{} / {} images in {:.2f} s, {:.1f} images/s, {} failed", images, images_.size(), elapsed,
+        elapsed > 0 ? images / elapsed : 0.0, failed());
+    batcher_.log_stats(*logger_);
+    StageTimers::log(*logger_);
+}
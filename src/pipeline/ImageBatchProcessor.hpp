@@ -0,0 +1,75 @@
+#pragma once
+#include "SlotBatcher.hpp"
+#include "DetectionSink.hpp"
+#include "LabelSpriteCache.hpp"
+#include <thread>
+
+// Still image archives: a directory, a glob pattern or a list file (one path per line)
+bool is_image_batch_source(const std::string& source);
+
+// Image paths of the source, sorted for directories and patterns, in file order for list files
+std::vector<std::string> list_images(const std::string& source);
+
+// Runs a list of still images through one engine. Worker threads pull the next image from the list,
+// decode it (JPEGs much larger than the network input at a reduced scale, see decode_image) and
+// preprocess it into one of their slots with their own detector; a batcher thread gathers the
+// preprocessed images of all workers into batches of up to max_batch and routes the outputs back,
+// the workers then postprocess (boxes in full resolution coordinates), write the detections to the
+// sink (producer = worker, frame = position in the list, the sink is made blocking so no record is
+// lost) and optionally save the annotated image as a JPEG in annotate_dir.
+class ImageBatchProcessor
+{
+public:
+    using DetectorFactory = std::function<std::unique_ptr<Detector>()>;
+
+    // 0 workers uses one per hardware thread, the sink needs at least as many producers
+    ImageBatchProcessor(
+        std::vector<std::string> images,
+        const DetectorFactory& make_detector,
+        InferenceInterface& engine,
+        DetectionSink* sink,
+        const std::vector<std::string>& labels,
+        const std::string& annotate_dir = "",
+        size_t workers = 0,
+        size_t max_batch = 8,
+        std::chrono::microseconds batch_timeout = std::chrono::milliseconds(5),
+        size_t depth = 2);
+
+    // Blocks until every image is processed
+    void run();
+
+    size_t workers() const { return workers_.size(); }
+    uint64_t processed() const { return processed_.load(std::memory_order_relaxed); }
+    uint64_t failed() const { return failed_.load(std::memory_order_relaxed); }
+
+    static void SetLogger(const std::shared_ptr<spdlog::logger>& logger)
+    {
+        logger_ = logger;
+    }
+
+private:
+    struct Worker
+    {
+        Worker(std::unique_ptr<Detector> detector, const std::vector<std::string>& labels);
+
+        std::unique_ptr<Detector> detector;
+        LabelSpriteCache label_sprites;
+    };
+
+    void worker_loop(size_t index);
+    SlotBatcher::Fill decode_next_image(size_t index, FrameSlot& slot);
+    void finish_image(size_t index, FrameSlot& slot);
+    void log_stats(std::chrono::steady_clock::time_point start) const;
+
+    std::vector<std::string> images_;
+    std::vector<std::unique_ptr<Worker>> workers_;
+    SlotBatcher batcher_;
+    DetectionSink* sink_;
+    std::string annotate_dir_;
+
+    std::atomic<size_t> next_image_{0};
+    std::atomic<uint64_t> processed_{0};
+    std::atomic<uint64_t> failed_{0};
+
+    static std::shared_ptr<spdlog::logger> logger_;
+};
@@ -0,0 +1,117 @@
+#include "ImageDecode.hpp"
+
+namespace
+{
+    bool read_u16(std::istream& in, int& value)
+    {
+        unsigned char bytes[2];
+        if (!in.read(reinterpret_cast<char*>(bytes), 2))
+        {
+            return false;
+        }
+        value = (bytes[0] << 8) | bytes[1];
+        return true;
+    }
+}
+
+
+cv::Size read_jpeg_size(const std::string& path)
+{
+    std::ifstream in(path, std::ios::binary);
+    int soi;
+    if (!read_u16(in, soi) || soi != 0xFFD8)
+    {
+        return {};
+    }
+
+    // Walk the marker segments up to the start of frame
+    for (;;)
+    {
+        int c = in.get();
+        if (c != 0xFF)
+        {
+            return {};
+        }
+        int marker;
+        do
+        {
+            marker = in.get();
+        } while (marker == 0xFF);
+        if (marker == EOF)
+        {
+            return {};
+        }
+        // Standalone markers have no length
+        if (marker == 0x01 || (marker >= 0xD0 && marker <= 0xD7))
+        {
+            continue;
+        }
+
+        int length;
+        if (!read_u16(in, length) || length < 2)
+        {
+            return {};
+        }
+        // SOF0 to SOF15, except DHT, JPG and DAC which share the range
+        if (marker >= 0xC0 && marker <= 0xCF && marker != 0xC4 && marker != 0xC8 && marker != 0xCC)
+        {
+            int height, width;
+            in.get();   // Sample precision
+            if (!read_u16(in, height) || !read_u16(in, width))
+            {
+                return {};
+            }
+            return cv::Size(width, height);
+        }
+        // Start of scan before any frame header, not a valid JPEG
+        if (marker == 0xDA)
+        {
+            return {};
+        }
+        in.seekg(length - 2, std::ios::cur);
+    }
+}
+
+
+int reduced_decode_factor(const cv::Size& image_size, const cv::Size& network_size)
+{
+    if (image_size.empty() || network_size.width <= 0 || network_size.height <= 0)
+    {
+        return 1;
+    }
+    // The decoder rounds the reduced size up
+    for (int factor : {8, 4, 2})
+    {
+        if ((image_size.width + factor - 1) / factor >= network_size.width &&
+            (image_size.height + factor - 1) / factor >= network_size.height)
+        {
+            return factor;
+        }
+    }
+    return 1;
+}
+
+
+cv::Mat decode_image(const std::string& path, const cv::Size& network_size, cv::Size& image_size)
+{
+    // Both orientations, the header size is before the EXIF rotation imread applies
+    cv::Size header_size = read_jpeg_size(path);
+    const int factor = std::min(reduced_decode_factor(header_size, network_size),
+        reduced_decode_factor(cv::Size(header_size.height, header_size.width), network_size));
+
+    if (factor == 1)
+    {
+        cv::Mat image = cv::imread(path, cv::IMREAD_COLOR);
+        image_size = image.size();
+        return image;
+    }
+
+    const int flags = factor == 8 ? cv::IMREAD_REDUCED_COLOR_8 : factor == 4 ? cv::IMREAD_REDUCED_COLOR_4 : cv::IMREAD_REDUCED_COLOR_2;
+    cv::Mat image = cv::imread(path, flags);
+    if ((image.cols > image.rows) != (header_size.width > header_size.height))
+    {
+        std::swap(header_size.width, header_size.height);
+    }
+    image_size = image.empty() ? cv::Size() : header_size;
+    return image;
+}
@@ -0,0 +1,13 @@
+#pragma once
+#include "common.hpp"
+
+// Width and height from the JPEG frame header, without decoding the image. Empty for other formats.
+cv::Size read_jpeg_size(const std::string& path);
+
+// Largest of 8, 4 and 2 that keeps both sides of the decoded image at least the network input size, else 1
+int reduced_decode_factor(const cv::Size& image_size, const cv::Size& network_size);
+
+// Decodes JPEGs much larger than the network input with IMREAD_REDUCED_COLOR_{2,4,8}, the JPEG decoder
+// then skips most of the IDCT work and the full resolution image is never allocated. image_size gets the
+// full resolution size (EXIF orientation applied), which postprocess maps the boxes to.
+cv::Mat decode_image(const std::string& path, const cv::Size& network_size, cv::Size& image_size);
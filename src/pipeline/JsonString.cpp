@@ -0,0 +1,36 @@
+#include "JsonString.hpp"
+
+void append_json_string(std::string& out, const std::string& value)
+{
+    for (const char c : value)
+    {
+        switch (c)
+        {
+        case '"': out += "\\\""; break;
+        case '\\': out += "\\\\"; break;
+        case '\b': out += "\\b"; break;
+        case '\f': out += "\\f"; break;
+        case '\n': out += "\\n"; break;
+        case '\r': out += "\\r"; break;
+        case '\t': out += "\\t"; break;
+        default:
+            if (static_cast<unsigned char>(c) < 0x20)
+            {
+                fmt::format_to(std::back_inserter(out), "\\u{:04x}", static_cast<unsigned>(static_cast<unsigned char>(c)));
+            }
+            else
+            {
+                out += c;
+            }
+        }
+    }
+}
+
+
+std::string json_string(const std::string& value)
+{
+    std::string escaped;
+    escaped.reserve(value.size());
+    append_json_string(escaped, value);
+    return escaped;
+}
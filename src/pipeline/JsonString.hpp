@@ -0,0 +1,9 @@
+#pragma once
+#include "common.hpp"
+
+// Appends value as JSON string contents: quotes, backslashes and control characters escaped, the
+// rest (UTF-8 included) copied as is
+void append_json_string(std::string& out, const std::string& value);
+
+// Escaped copy of value, for building a whole JSON document with fmt::format
+std::string json_string(const std::string& value);
@@ -0,0 +1,57 @@
+#include "LabelSpriteCache.hpp"
+
+namespace
+{
+    constexpr float font_scale = 0.7;
+    constexpr int font_face = cv::FONT_HERSHEY_DUPLEX;
+    constexpr int thickness = 2;
+}
+
+
+LabelSpriteCache::LabelSpriteCache(const std::vector<std::string>& labels) :
+    labels_{labels},
+    sprites_(labels.size() * score_buckets),
+    text_heights_(labels.size() * score_buckets, 0)
+{
+}
+
+
+const cv::Mat& LabelSpriteCache::sprite(int class_id, int bucket)
+{
+    const size_t key = static_cast<size_t>(class_id) * score_buckets + bucket;
+    cv::Mat& cached = sprites_[key];
+    if (cached.empty())
+    {
+        std::ostringstream out;
+        out << std::fixed << std::setprecision(2) << bucket / 100.0;
+        const std::string text = labels_[class_id] + ": " + out.str();
+
+        int baseline;
+        const cv::Size text_size = cv::getTextSize(text, font_face, font_scale, thickness, &baseline);
+        // Filled rectangles include their bottom right corner
+        cached.create(text_size.height + baseline + 1, text_size.width + 1, CV_8UC3);
+        cached.setTo(cv::Scalar(255, 0, 255));
+        cv::putText(cached, text, cv::Point(0, text_size.height), font_face, font_scale, cv::Scalar(0, 255, 255), thickness);
+        text_heights_[key] = text_size.height;
+    }
+    return cached;
+}
+
+
+void LabelSpriteCache::draw(cv::Mat& image, int class_id, float score, int left, int top)
+{
+    if (class_id < 0 || static_cast<size_t>(class_id) >= labels_.size())
+    {
+        return;
+    }
+    const int bucket = std::clamp(static_cast<int>(score * 100), 0, score_buckets - 1);
+    const cv::Mat& label = sprite(class_id, bucket);
+    top = std::max(top, text_heights_[static_cast<size_t>(class_id) * score_buckets + bucket]);
+
+    const cv::Rect target = cv::Rect(left, top, label.cols, label.rows) & cv::Rect(0, 0, image.cols, image.rows);
+    if (target.empty())
+    {
+        return;
+    }
+    label(cv::Rect(target.x - left, target.y - top, target.width, target.height)).copyTo(image(target));
+}
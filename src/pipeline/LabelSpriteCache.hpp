@@ -0,0 +1,22 @@
+#pragma once
+#include "common.hpp"
+
+// Pre-rasterized labels, one sprite per class and score bucket (the 2 decimals draw_label shows),
+// created on first use. Drawing a label is then a clipped copy instead of getTextSize + putText.
+// Same look and placement as draw_label in utils.hpp.
+class LabelSpriteCache
+{
+public:
+    explicit LabelSpriteCache(const std::vector<std::string>& labels);
+
+    void draw(cv::Mat& image, int class_id, float score, int left, int top);
+
+private:
+    static constexpr int score_buckets = 101;
+
+    const cv::Mat& sprite(int class_id, int bucket);
+
+    std::vector<std::string> labels_;
+    std::vector<cv::Mat> sprites_;          // class_id * score_buckets + bucket, empty until used
+    std::vector<int> text_heights_;         // Per sprite, the label is lowered by it at the image top
+};
@@ -0,0 +1,93 @@
+#include "MultiStreamServer.hpp"
+
+std::shared_ptr<spdlog::logger> MultiStreamServer::logger_;
+
+
+MultiStreamServer::MultiStreamServer(
+    std::vector<std::unique_ptr<VideoCaptureInterface>> sources,
+    const DetectorFactory& make_detector,
+    InferenceInterface& engine,
+    size_t max_batch,
+    std::chrono::microseconds batch_timeout,
+    size_t depth) :
+    batcher_{engine, sources.size(), max_batch, batch_timeout, depth}
+{
+    for (auto& source : sources)
+    {
+        auto stream = std::make_unique<Stream>();
+        stream->capture = std::move(source);
+        stream->detector = make_detector();
+        streams_.push_back(std::move(stream));
+    }
+}
+
+
+void MultiStreamServer::run(const DetectionCallback& on_detections)
+{
+    const auto start = std::chrono::steady_clock::now();
+    std::vector<std::thread> threads;
+    for (size_t i = 0; i < streams_.size(); ++i)
+    {
+        threads.emplace_back(&MultiStreamServer::stream_loop, this, i, std::cref(on_detections));
+    }
+    std::thread batcher(&SlotBatcher::run_batcher, &batcher_, [this, start] { log_stats(start); });
+
+    for (auto& thread : threads)
+    {
+        thread.join();
+    }
+    batcher.join();
+    log_stats(start);
+}
+
+
+// Capture and preprocess into free slots while the batcher holds the others, postprocess them as they come back
+void MultiStreamServer::stream_loop(size_t index, const DetectionCallback& on_detections)
+{
+    Trace::set_thread_name(fmt::format("stream {}", index));
+    Stream& stream = *streams_[index];
+    const auto fill = [&stream](FrameSlot& slot)
+    {
+        const auto start = StageTimers::Clock::now();
+        bool captured;
+        {
+            AllocationScope allocations(Stage::Capture);
+            captured = stream.capture->readFrame(slot.frame) && !slot.frame.empty();
+        }
+        if (!captured)
+        {
+            return SlotBatcher::Fill::Ended;
+        }
+        slot.index = stream.next_frame++;
+        StageTimers::record(Stage::Capture, start, StageTimers::Clock::now());
+        {
+            ScopedStageTimer timer(Stage::Preprocess);
+            stream.detector->preprocess_image(slot.frame, slot.blob);
+        }
+        return SlotBatcher::Fill::Ready;
+    };
+    const auto finish = [&stream, index, &on_detections](FrameSlot& slot)
+    {
+        {
+            ScopedStageTimer timer(Stage::Postprocess);
+            stream.detector->postprocess(slot.outputs, slot.frame.size(), slot.detections);
+        }
+        slot.outputs.clear();
+        on_detections(index, slot.index, slot.frame, slot.detections);
+        stream.frames.fetch_add(1, std::memory_order_relaxed);
+    };
+    batcher_.run_producer(index, fill, finish);
+}
+
+
+void MultiStreamServer::log_stats(std::chrono::steady_clock::time_point start) const
+{
+    const double elapsed = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+    for (size_t i = 0; i < streams_.size(); ++i)
+    {
+        const uint64_t frames = streams_[i]->frames.load(std::memory_order_relaxed);
+        logger_->info("Stream {}: {} frames, {:.1f} FPS", i, frames, elapsed > 0 ? frames / elapsed : 0.0);
+    }
+    batcher_.log_stats(*logger_);
+    StageTimers::log(*logger_);
+}
@@ -0,0 +1,49 @@
+#pragma once
+#include "SlotBatcher.hpp"
+#include "VideoCaptureInterface.hpp"
+#include <thread>
+
+// Serves several video sources with one shared engine. Every stream has its own thread and
+// detector instance for capture, preprocessing and postprocessing; a single batcher thread
+// gathers the preprocessed frames of all streams until max_batch frames are ready or the
+// oldest one waited batch_timeout, runs them as one batch and routes the outputs back.
+class MultiStreamServer
+{
+public:
+    // Called on the stream's thread for every frame, in capture order within a stream
+    using DetectionCallback = std::function<void(size_t stream, uint64_t frame_index, const cv::Mat& frame, const std::vector<Detection>& detections)>;
+    using DetectorFactory = std::function<std::unique_ptr<Detector>()>;
+
+    MultiStreamServer(
+        std::vector<std::unique_ptr<VideoCaptureInterface>> sources,
+        const DetectorFactory& make_detector,
+        InferenceInterface& engine,
+        size_t max_batch = 8,
+        std::chrono::microseconds batch_timeout = std::chrono::milliseconds(5),
+        size_t depth = 2);
+
+    // Blocks until every source is exhausted
+    void run(const DetectionCallback& on_detections);
+
+    static void SetLogger(const std::shared_ptr<spdlog::logger>& logger)
+    {
+        logger_ = logger;
+    }
+
+private:
+    struct Stream
+    {
+        std::unique_ptr<VideoCaptureInterface> capture;
+        std::unique_ptr<Detector> detector;
+        uint64_t next_frame{0};
+        std::atomic<uint64_t> frames{0};
+    };
+
+    void stream_loop(size_t index, const DetectionCallback& on_detections);
+    void log_stats(std::chrono::steady_clock::time_point start) const;
+
+    std::vector<std::unique_ptr<Stream>> streams_;
+    SlotBatcher batcher_;
+
+    static std::shared_ptr<spdlog::logger> logger_;
+};
@@ -0,0 +1,270 @@
+#include "PipelineExecutor.hpp"
+
+// A batch needs at least batch_size slots in flight, and every queue must also fit the end of stream marker on top of all the slots
+PipelineExecutor::PipelineExecutor(VideoCaptureInterface& capture, Detector& detector, InferenceInterface& engine, size_t depth, size_t batch_size,
+    std::chrono::microseconds latency_budget) :
+    capture_{capture},
+    detector_{detector},
+    engine_{engine},
+    batch_size_{std::max<size_t>(batch_size, 1)},
+    async_inference_{batch_size_ == 1 && engine.max_outstanding() > 1},
+    scheduler_{latency_budget},
+    slots_(std::max({depth, batch_size_, size_t{1}})),
+    free_{slots_.size() + 1},
+    captured_{slots_.size() + 1},
+    preprocessed_{slots_.size() + 1},
+    inferred_{slots_.size() + 1},
+    postprocessed_{slots_.size() + 1}
+{
+}
+
+
+void PipelineExecutor::run(const RenderCallback& render)
+{
+    stop_ = false;
+    for (int i = 0; i < static_cast<int>(slots_.size()); ++i)
+    {
+        push_wait(free_, i);
+    }
+
+    std::thread capture_thread(&PipelineExecutor::capture_stage, this);
+    std::thread preprocess_thread(&PipelineExecutor::preprocess_stage, this);
+    std::thread inference_thread(&PipelineExecutor::inference_stage, this);
+    std::thread postprocess_thread(&PipelineExecutor::postprocess_stage, this);
+
+    // Keep draining after a stop request so upstream stages reach the end of stream marker
+    for (int s = pop_wait(postprocessed_); s != end_of_stream; s = pop_wait(postprocessed_))
+    {
+        FrameSlot& slot = slots_[s];
+        if (!stop_ && slot.decision != FrameDecision::Skip && !render(slot.index, slot.frame, slot.detections))
+        {
+            stop_ = true;
+        }
+        scheduler_.record_done(slot.capture_time, slot.decision);
+        push_wait(free_, s);
+    }
+
+    capture_thread.join();
+    preprocess_thread.join();
+    inference_thread.join();
+    postprocess_thread.join();
+
+    // Leave the queues empty for a next run
+    int s;
+    while (free_.try_pop(s))
+    {
+    }
+}
+
+
+void PipelineExecutor::capture_stage()
+{
+    Trace::set_thread_name("capture");
+    uint64_t index = 0;
+    while (!stop_)
+    {
+        const int s = pop_wait(free_);
+        FrameSlot& slot = slots_[s];
+        AllocationScope allocations(Stage::Capture);
+        const auto start = FrameScheduler::Clock::now();
+        if (!capture_.readFrame(slot.frame) || slot.frame.empty())
+        {
+            break;
+        }
+        slot.index = index++;
+        slot.capture_time = FrameScheduler::Clock::now();
+        StageTimers::record(Stage::Capture, start, slot.capture_time);
+        slot.decision = scheduler_.decide(slot.capture_time);
+        push_wait(captured_, s);
+    }
+    push_wait(captured_, end_of_stream);
+}
+
+
+void PipelineExecutor::preprocess_stage()
+{
+    Trace::set_thread_name("preprocess");
+    for (int s = pop_wait(captured_); s != end_of_stream; s = pop_wait(captured_))
+    {
+        FrameSlot& slot = slots_[s];
+        // Frames that waited past the budget would only be shown late, drop them to catch up
+        if (scheduler_.expired(slot.capture_time))
+        {
+            if (slot.decision == FrameDecision::Infer)
+            {
+                scheduler_.cancel_inference();
+            }
+            slot.decision = FrameDecision::Skip;
+        }
+        if (slot.decision == FrameDecision::Infer)
+        {
+            AllocationScope allocations(Stage::Preprocess);
+            const auto start = FrameScheduler::Clock::now();
+            detector_.preprocess_image(slot.frame, slot.blob);
+            const auto stage_end = FrameScheduler::Clock::now();
+            scheduler_.record_preprocess(stage_end - start);
+            StageTimers::record(Stage::Preprocess, start, stage_end);
+        }
+        push_wait(preprocessed_, s);
+    }
+    push_wait(preprocessed_, end_of_stream);
+}
+
+
+void PipelineExecutor::inference_stage()
+{
+    Trace::set_thread_name("inference");
+    if (async_inference_)
+    {
+        async_inference_stage();
+        return;
+    }
+
+    // Frames not inferred travel with the batch to keep the order, and close it so they aren't held back
+    std::vector<int> batch;
+    std::vector<int> infer;
+    std::vector<cv::Mat> blobs;
+    bool end = false;
+    while (!end)
+    {
+        batch.clear();
+        infer.clear();
+        while (infer.size() < batch_size_)
+        {
+            const int s = pop_wait(preprocessed_);
+            if (s == end_of_stream)
+            {
+                end = true;
+                break;
+            }
+            batch.push_back(s);
+            if (slots_[s].decision != FrameDecision::Infer)
+            {
+                break;
+            }
+            infer.push_back(s);
+        }
+
+        AllocationScope allocations(Stage::Inference);
+        const auto start = FrameScheduler::Clock::now();
+        if (infer.size() == 1)
+        {
+            FrameSlot& slot = slots_[infer.front()];
+            keep_outputs(engine_, engine_.get_infer_results(slot.blob), slot);
+        }
+        else if (infer.size() > 1)
+        {
+            blobs.clear();
+            for (const int s : infer)
+            {
+                blobs.push_back(slots_[s].blob);
+            }
+            std::vector<std::vector<TensorView>> outputs = engine_.get_infer_results_batch(blobs);
+            for (size_t i = 0; i < infer.size(); ++i)
+            {
+                keep_outputs(engine_, std::move(outputs[i]), slots_[infer[i]]);
+            }
+        }
+        if (!infer.empty())
+        {
+            const auto stage_end = FrameScheduler::Clock::now();
+            StageTimers::record(Stage::Inference, start, stage_end);
+            const auto per_frame = (stage_end - start) / infer.size();
+            for (size_t i = 0; i < infer.size(); ++i)
+            {
+                scheduler_.record_inference(per_frame);
+            }
+        }
+
+        for (const int s : batch)
+        {
+            push_wait(inferred_, s);
+        }
+    }
+    push_wait(inferred_, end_of_stream);
+}
+
+
+// Keeps up to max_outstanding() frames in flight on engines running several requests at once,
+// completed frames are still handed to postprocessing in capture order
+void PipelineExecutor::async_inference_stage()
+{
+    const size_t max_in_flight = std::min(engine_.max_outstanding(), slots_.size());
+    // Frames not inferred wait in line with an invalid future
+    std::deque<std::pair<int, std::future<std::vector<TensorView>>>> in_flight;
+    bool end = false;
+    Backoff backoff;
+    while (!end || !in_flight.empty())
+    {
+        int s;
+        if (!end && in_flight.size() < max_in_flight && preprocessed_.try_pop(s))
+        {
+            if (s == end_of_stream)
+            {
+                end = true;
+            }
+            else if (slots_[s].decision == FrameDecision::Infer)
+            {
+                slots_[s].inference_start = FrameScheduler::Clock::now();
+                in_flight.emplace_back(s, engine_.infer_async(slots_[s].blob));
+            }
+            else
+            {
+                in_flight.emplace_back(s, std::future<std::vector<TensorView>>());
+            }
+            backoff.reset();
+            continue;
+        }
+
+        // Block on the oldest frame only when nothing else can move
+        if (!in_flight.empty() && (end || in_flight.size() == max_in_flight || !in_flight.front().second.valid() ||
+            in_flight.front().second.wait_for(std::chrono::seconds(0)) == std::future_status::ready))
+        {
+            const int oldest = in_flight.front().first;
+            if (in_flight.front().second.valid())
+            {
+                slots_[oldest].outputs = in_flight.front().second.get();
+                const auto stage_end = FrameScheduler::Clock::now();
+                scheduler_.record_inference(stage_end - slots_[oldest].inference_start);
+                StageTimers::record(Stage::Inference, slots_[oldest].inference_start, stage_end);
+            }
+            push_wait(inferred_, oldest);
+            in_flight.pop_front();
+            backoff.reset();
+            continue;
+        }
+        backoff.wait();
+    }
+    push_wait(inferred_, end_of_stream);
+}
+
+
+void PipelineExecutor::postprocess_stage()
+{
+    Trace::set_thread_name("postprocess");
+    for (int s = pop_wait(inferred_); s != end_of_stream; s = pop_wait(inferred_))
+    {
+        FrameSlot& slot = slots_[s];
+        if (slot.decision == FrameDecision::Infer)
+        {
+            const auto start = FrameScheduler::Clock::now();
+            {
+                AllocationScope allocations(Stage::Postprocess);
+                detector_.postprocess(slot.outputs, slot.frame.size(), slot.detections);
+                slot.outputs.clear();
+            }
+            const auto stage_end = FrameScheduler::Clock::now();
+            scheduler_.record_postprocess(stage_end - start);
+            StageTimers::record(Stage::Postprocess, start, stage_end);
+            // Kept for the frames reusing them, a larger detection count than before grows it
+            last_detections_ = slot.detections;
+        }
+        else if (slot.decision == FrameDecision::Reuse)
+        {
+            slot.detections = last_detections_;
+        }
+        push_wait(postprocessed_, s);
+    }
+    push_wait(postprocessed_, end_of_stream);
+}
+
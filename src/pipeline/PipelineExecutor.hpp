@@ -0,0 +1,56 @@
+#pragma once
+#include "FrameSlot.hpp"
+#include "VideoCaptureInterface.hpp"
+#include "SpscQueue.hpp"
+#include <deque>
+#include <functional>
+#include <thread>
+
+// Pipelined video loop: capture, preprocess, inference and postprocess each run on their own
+// thread, rendering on the caller's one. Stages hand frame slots over through SPSC queues, so
+// frames come out in capture order and at most depth frames are in flight at once.
+// With batch_size > 1 the inference stage gathers that many preprocessed frames (fewer at the
+// end of the stream) and runs them as one batch.
+// With a latency budget the FrameScheduler decides per frame whether it is inferred, shown with
+// the last detections or dropped, so live sources stay within the budget when inference can't keep up.
+class PipelineExecutor
+{
+public:
+    // Called for every frame in order, returning false stops the pipeline
+    using RenderCallback = std::function<bool(uint64_t frame_index, cv::Mat& frame, const std::vector<Detection>& detections)>;
+
+    PipelineExecutor(VideoCaptureInterface& capture, Detector& detector, InferenceInterface& engine, size_t depth = 4, size_t batch_size = 1,
+        std::chrono::microseconds latency_budget = std::chrono::microseconds(0));
+
+    // Blocks until the source is exhausted or the render callback asks to stop
+    void run(const RenderCallback& render);
+
+    // Processed, reused, skipped and late frame counters
+    const FrameScheduler& scheduler() const { return scheduler_; }
+
+private:
+    static constexpr int end_of_stream = -1;
+
+    void capture_stage();
+    void preprocess_stage();
+    void inference_stage();
+    void async_inference_stage();
+    void postprocess_stage();
+
+    VideoCaptureInterface& capture_;
+    Detector& detector_;
+    InferenceInterface& engine_;
+
+    size_t batch_size_;
+    bool async_inference_;
+    FrameScheduler scheduler_;
+    std::vector<Detection> last_detections_;    // Postprocess thread only
+    std::vector<FrameSlot> slots_;
+    // Slot indices flow free -> captured -> preprocessed -> inferred -> postprocessed -> free
+    SpscQueue<int> free_;
+    SpscQueue<int> captured_;
+    SpscQueue<int> preprocessed_;
+    SpscQueue<int> inferred_;
+    SpscQueue<int> postprocessed_;
+    std::atomic<bool> stop_{false};
+};
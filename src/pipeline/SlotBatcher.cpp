@@ -0,0 +1,177 @@
+#include "SlotBatcher.hpp"
+
+namespace
+{
+    constexpr auto stats_period = std::chrono::seconds(5);
+}
+
+
+// Queues fit every slot of the producer plus the end of stream marker
+SlotBatcher::Producer::Producer(size_t depth) :
+    slots(depth),
+    ready{depth + 1},
+    done{depth + 1}
+{
+}
+
+
+SlotBatcher::SlotBatcher(InferenceInterface& engine, size_t producers, size_t max_batch, std::chrono::microseconds batch_timeout, size_t depth) :
+    engine_{engine},
+    max_batch_{std::max<size_t>(max_batch, 1)},
+    batch_timeout_{batch_timeout}
+{
+    for (size_t i = 0; i < producers; ++i)
+    {
+        producers_.emplace_back(std::make_unique<Producer>(std::max<size_t>(depth, 1)));
+    }
+    batch_.reserve(max_batch_);
+}
+
+
+void SlotBatcher::run_producer(size_t index, const FillFunction& fill, const FinishFunction& finish)
+{
+    Producer& producer = *producers_[index];
+    std::vector<int> free_slots;
+    for (int i = static_cast<int>(producer.slots.size()) - 1; i >= 0; --i)
+    {
+        free_slots.push_back(i);
+    }
+
+    bool filling = true;
+    Backoff backoff;
+    while (filling || free_slots.size() < producer.slots.size())
+    {
+        int s;
+        bool progress = false;
+        while (producer.done.try_pop(s))
+        {
+            finish(producer.slots[s]);
+            free_slots.push_back(s);
+            progress = true;
+        }
+
+        if (filling && !free_slots.empty())
+        {
+            s = free_slots.back();
+            switch (fill(producer.slots[s]))
+            {
+            case Fill::Ready:
+                free_slots.pop_back();
+                push_wait(producer.ready, s);
+                break;
+            case Fill::Skipped:
+                break;
+            case Fill::Ended:
+                filling = false;
+                push_wait(producer.ready, end_of_stream);
+                break;
+            }
+            progress = true;
+        }
+
+        if (progress)
+        {
+            backoff.reset();
+        }
+        else
+        {
+            backoff.wait();
+        }
+    }
+}
+
+
+void SlotBatcher::run_batcher(const std::function<void()>& on_stats)
+{
+    Trace::set_thread_name("batcher");
+    auto next_stats = std::chrono::steady_clock::now() + stats_period;
+    std::vector<bool> ended(producers_.size(), false);
+    size_t active = producers_.size();
+    size_t next_producer = 0;
+    std::chrono::steady_clock::time_point deadline;
+    Backoff backoff;
+
+    while (active > 0 || !batch_.empty())
+    {
+        // Round robin, one slot per producer and sweep, so a fast source can't starve the others
+        bool progress = true;
+        while (progress && batch_.size() < max_batch_)
+        {
+            progress = false;
+            for (size_t n = 0; n < producers_.size() && batch_.size() < max_batch_; ++n)
+            {
+                const size_t i = (next_producer + n) % producers_.size();
+                int s;
+                if (ended[i] || !producers_[i]->ready.try_pop(s))
+                {
+                    continue;
+                }
+                if (s == end_of_stream)
+                {
+                    ended[i] = true;
+                    --active;
+                    continue;
+                }
+                if (batch_.empty())
+                {
+                    deadline = std::chrono::steady_clock::now() + batch_timeout_;
+                }
+                batch_.push_back({i, s});
+                progress = true;
+            }
+        }
+        next_producer = (next_producer + 1) % std::max<size_t>(producers_.size(), 1);
+
+        const auto now = std::chrono::steady_clock::now();
+        if (batch_.size() == max_batch_ || (!batch_.empty() && (now >= deadline || active == 0)))
+        {
+            run_batch();
+            backoff.reset();
+        }
+        else
+        {
+            backoff.wait();
+        }
+
+        if (now >= next_stats)
+        {
+            on_stats();
+            next_stats = now + stats_period;
+        }
+    }
+}
+
+
+void SlotBatcher::run_batch()
+{
+    batch_blobs_.clear();
+    for (const BatchEntry& entry : batch_)
+    {
+        batch_blobs_.push_back(producers_[entry.producer]->slots[entry.slot].blob);
+    }
+
+    AllocationScope allocations(Stage::Inference);
+    const auto start = StageTimers::Clock::now();
+    std::vector<std::vector<TensorView>> outputs = engine_.get_infer_results_batch(batch_blobs_);
+    StageTimers::record(Stage::Inference, start, StageTimers::Clock::now());
+    for (size_t i = 0; i < batch_.size(); ++i)
+    {
+        Producer& producer = *producers_[batch_[i].producer];
+        keep_outputs(engine_, std::move(outputs[i]), producer.slots[batch_[i].slot]);
+        push_wait(producer.done, batch_[i].slot);
+    }
+
+    ++batches_;
+    batched_slots_ += batch_.size();
+    batch_.clear();
+}
+
+
+void SlotBatcher::log_stats(spdlog::logger& logger) const
+{
+    if (batches_ > 0)
+    {
+        const double mean_batch = static_cast<double>(batched_slots_) / batches_;
+        logger.info("Batches: {}, mean size {:.2f}, fill ratio {:.1f}%", batches_, mean_batch, 100.0 * mean_batch / max_batch_);
+    }
+}
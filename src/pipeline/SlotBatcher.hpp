@@ -0,0 +1,68 @@
+#pragma once
+#include "FrameSlot.hpp"
+#include "SpscQueue.hpp"
+#include <functional>
+
+// Cross producer batching shared by the multi stream and batch image modes. Every producer thread
+// fills its own slots (capture or decode, then preprocess) and hands them over through its ready
+// queue; the batcher thread gathers the slots of all producers round robin until max_batch are
+// ready or the oldest one waited batch_timeout, runs them as one batch and routes the outputs back
+// through the producer's done queue for postprocessing.
+class SlotBatcher
+{
+public:
+    // What a producer got for a free slot
+    enum class Fill
+    {
+        Ready,      // Preprocessed, goes to the batcher
+        Skipped,    // Nothing usable (e.g. a corrupt image), the slot stays free
+        Ended       // Source exhausted
+    };
+    using FillFunction = std::function<Fill(FrameSlot& slot)>;
+    using FinishFunction = std::function<void(FrameSlot& slot)>;
+
+    SlotBatcher(InferenceInterface& engine, size_t producers, size_t max_batch, std::chrono::microseconds batch_timeout, size_t depth);
+
+    // Producer thread: fills free slots while the batcher holds the others and finishes them
+    // as they come back, until fill reports the end and every slot is finished
+    void run_producer(size_t index, const FillFunction& fill, const FinishFunction& finish);
+
+    // Batcher thread: runs until every producer ended, calls on_stats every few seconds
+    void run_batcher(const std::function<void()>& on_stats);
+
+    // Batch count and fill ratio
+    void log_stats(spdlog::logger& logger) const;
+
+    size_t producers() const { return producers_.size(); }
+
+private:
+    struct Producer
+    {
+        explicit Producer(size_t depth);
+
+        std::vector<FrameSlot> slots;
+        SpscQueue<int> ready;   // producer -> batcher, preprocessed slots
+        SpscQueue<int> done;    // batcher -> producer, slots with outputs
+    };
+
+    // Slot of a producer queued for the next batch
+    struct BatchEntry
+    {
+        size_t producer;
+        int slot;
+    };
+
+    static constexpr int end_of_stream = -1;
+
+    void run_batch();
+
+    std::vector<std::unique_ptr<Producer>> producers_;
+    InferenceInterface& engine_;
+    size_t max_batch_;
+    std::chrono::microseconds batch_timeout_;
+
+    std::vector<BatchEntry> batch_;
+    std::vector<cv::Mat> batch_blobs_;
+    uint64_t batches_{0};
+    uint64_t batched_slots_{0};
+};
@@ -0,0 +1,131 @@
+#pragma once
+#include <atomic>
+#include <chrono>
+#include <cstddef>
+#include <thread>
+#include <vector>
+#if defined(__SSE2__)
+#include <immintrin.h>
+#endif
+
+// Bounded lock-free single producer / single consumer ring.
+// Exactly one thread may push and exactly one (other) thread may pop.
+template <typename T>
+class SpscQueue
+{
+public:
+    explicit SpscQueue(size_t capacity)
+    {
+        size_t size = 1;
+        while (size < capacity)
+            size <<= 1;
+        buffer_.resize(size);
+        mask_ = size - 1;
+    }
+
+    SpscQueue(const SpscQueue&) = delete;
+    SpscQueue& operator=(const SpscQueue&) = delete;
+
+    size_t capacity() const { return buffer_.size(); }
+
+    bool try_push(const T& value)
+    {
+        const size_t tail = tail_.load(std::memory_order_relaxed);
+        if (tail - cached_head_ == buffer_.size())
+        {
+            cached_head_ = head_.load(std::memory_order_acquire);
+            if (tail - cached_head_ == buffer_.size())
+                return false;
+        }
+        buffer_[tail & mask_] = value;
+        tail_.store(tail + 1, std::memory_order_release);
+        return true;
+    }
+
+    bool try_push(T&& value)
+    {
+        const size_t tail = tail_.load(std::memory_order_relaxed);
+        if (tail - cached_head_ == buffer_.size())
+        {
+            cached_head_ = head_.load(std::memory_order_acquire);
+            if (tail - cached_head_ == buffer_.size())
+                return false;
+        }
+        buffer_[tail & mask_] = std::move(value);
+        tail_.store(tail + 1, std::memory_order_release);
+        return true;
+    }
+
+    bool try_pop(T& value)
+    {
+        const size_t head = head_.load(std::memory_order_relaxed);
+        if (head == cached_tail_)
+        {
+            cached_tail_ = tail_.load(std::memory_order_acquire);
+            if (head == cached_tail_)
+                return false;
+        }
+        value = std::move(buffer_[head & mask_]);
+        head_.store(head + 1, std::memory_order_release);
+        return true;
+    }
+
+private:
+    std::vector<T> buffer_;
+    size_t mask_{0};
+
+    // Producer and consumer indices on their own cache lines, each side keeps a
+    // cached copy of the other index and only reloads it when the ring looks full/empty
+    alignas(64) std::atomic<size_t> head_{0};
+    size_t cached_tail_{0};
+    alignas(64) std::atomic<size_t> tail_{0};
+    size_t cached_head_{0};
+};
+
+// Spin, then yield, then sleep: short waits stay cheap while an idle stage
+// doesn't steal cores from the inference threads
+class Backoff
+{
+public:
+    void wait()
+    {
+        if (count_ < 64)
+        {
+#if defined(__SSE2__)
+            _mm_pause();
+#endif
+        }
+        else if (count_ < 128)
+        {
+            std::this_thread::yield();
+        }
+        else
+        {
+            std::this_thread::sleep_for(std::chrono::microseconds(100));
+        }
+        ++count_;
+    }
+
+    void reset() { count_ = 0; }
+
+private:
+    unsigned count_{0};
+};
+
+template <typename T>
+void push_wait(SpscQueue<T>& queue, const T& value)
+{
+    Backoff backoff;
+    while (!queue.try_push(value))
+        backoff.wait();
+}
+
+template <typename T>
+T pop_wait(SpscQueue<T>& queue)
+{
+    Backoff backoff;
+    T value;
+    while (!queue.try_pop(value))
+        backoff.wait();
+    return value;
+}
@@ -0,0 +1,120 @@
+#pragma once
+#include <opencv2/core/core.hpp>
+#include <chrono>
+#include <condition_variable>
+#include <cstdint>
+#include <mutex>
+#include <vector>
+
+struct FrameInfo
+{
+    uint64_t sequence{0};                           // Position in the stream, dropped frames leave gaps
+    int64_t pts_ns{-1};                             // Presentation timestamp of the source, -1 when unknown
+    std::chrono::steady_clock::time_point arrival;  // When the producer finished writing it
+};
+
+struct CapturedFrame
+{
+    cv::Mat image;
+    FrameInfo info;
+};
+
+// Fixed capacity ring of frame slots between one producer thread (the GStreamer streaming thread) and
+// one reader. The producer fills a free slot outside the lock, writing into the slot's buffer or
+// replacing it, and the reader takes the oldest frame by swapping Mats with the slot: the frame
+// changes hands without a copy and the slot keeps the reader's previous buffer to write a later frame
+// into. When all the other slots hold unread frames the oldest is dropped, a live source never waits
+// for the reader.
+class FrameRing
+{
+public:
+    explicit FrameRing(size_t capacity = 4) :
+        slots_(std::max<size_t>(capacity, 2))
+    {
+    }
+
+    FrameRing(const FrameRing&) = delete;
+    FrameRing& operator=(const FrameRing&) = delete;
+
+    // Producer: slot to write the next frame into, its image is a buffer to reuse. A full ring drops
+    // (and counts) its oldest frame here, so only call it for a frame that will be committed
+    CapturedFrame& begin_write()
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        if (count_ == slots_.size() - 1)
+        {
+            head_ = (head_ + 1) % slots_.size();
+            --count_;
+            ++dropped_;
+        }
+        return slots_[(head_ + count_) % slots_.size()];
+    }
+
+    // Producer: publishes the slot returned by the last begin_write
+    void commit_write(int64_t pts_ns)
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        CapturedFrame& slot = slots_[(head_ + count_) % slots_.size()];
+        slot.info.sequence = next_sequence_++;
+        slot.info.pts_ns = pts_ns;
+        slot.info.arrival = std::chrono::steady_clock::now();
+        ++count_;
+        ready_.notify_one();
+    }
+
+    // End of stream (or error), the frames already written can still be read
+    void close()
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        closed_ = true;
+        ready_.notify_all();
+    }
+
+    // Reader: takes the oldest frame into image, waiting up to timeout. false on timeout or when finished().
+    // image's previous buffer goes to the producer unless something else still references it.
+    bool read(cv::Mat& image, FrameInfo* info, std::chrono::milliseconds timeout)
+    {
+        std::unique_lock<std::mutex> lock(mutex_);
+        if (!ready_.wait_for(lock, timeout, [this] { return count_ > 0 || closed_; }) || count_ == 0)
+        {
+            return false;
+        }
+        if (!image.u || image.u->refcount > 1)
+        {
+            image.release();
+        }
+        CapturedFrame& slot = slots_[head_];
+        std::swap(image, slot.image);
+        if (info)
+        {
+            *info = slot.info;
+        }
+        head_ = (head_ + 1) % slots_.size();
+        --count_;
+        return true;
+    }
+
+    bool finished() const
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        return closed_ && count_ == 0;
+    }
+
+    uint64_t dropped() const
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        return dropped_;
+    }
+
+private:
+    // Unread frames are head_ .. head_ + count_ - 1, the producer's slot is the one after them;
+    // reads advance head_ and shrink count_ together, so that slot never moves under the producer
+    std::vector<CapturedFrame> slots_;
+    size_t head_{0};
+    size_t count_{0};
+    uint64_t next_sequence_{0};
+    uint64_t dropped_{0};
+    bool closed_{false};
+    mutable std::mutex mutex_;
+    std::condition_variable ready_;
+};
@@ -1,15 +1,12 @@
 #pragma once
 #include "VideoCaptureInterface.hpp"
 #include "GStreamerOpenCV.hpp"
-#include <condition_variable>
-#include <mutex>
 
 class GStreamerCapture : public VideoCaptureInterface {
 private:
     GStreamerOpenCV gstocv;
     bool initialized = false; // Track initialization status
-    std::mutex frameMutex_; // Mutex to protect frame access
-    std::condition_variable frameAvailable_; // Condition variable to signal new frames
+    FrameInfo frameInfo_;     // Sequence number and timestamps of the last frame read
 
 public:
     bool initialize(const std::string& source) {
@@ -23,26 +20,43 @@ public:
         return true;
     }
 
+    // frame takes over the decoded frame without a copy. Its previous content is reused for a later
+    // frame, or released right away when it still holds a GStreamer sample.
     bool readFrame(cv::Mat& frame) override {
-        if (!initialized ||   GStreamerOpenCV::isEndOfStream()) {
+        if (!initialized) {
             // Handle attempts to read frames without proper initialization
             return false;
-        }   
+        }
+        if (GStreamerOpenCV::holdsSample(frame)) {
+            frame.release();
+        }
+        // Bus messages (errors, end of stream) are dispatched while waiting for the streaming thread
         gstocv.setMainLoopEvent(false);
-
-        {
-            std::unique_lock<std::mutex> lock(GStreamerOpenCV::frameMutex_);
-            GStreamerOpenCV::frameAvailable_.wait(lock, [this] { return GStreamerOpenCV::isFrameReady_; });
-            frame = gstocv.getFrame().clone();
-        }   
+        while (!gstocv.frames().read(frame, &frameInfo_, std::chrono::milliseconds(100))) {
+            if (gstocv.isEndOfStream()) {
+                return false;
+            }
+            gstocv.setMainLoopEvent(false);
+        }
         return !frame.empty();
     }
 
+    const FrameInfo& frameInfo() const {
+        return frameInfo_;
+    }
+
     void release() override {
         // Release GStreamer resources
         gstocv.setState(GST_STATE_NULL);
+        gstocv.frames().close();
+        if (gstocv.frames().dropped() > 0) {
+            g_print("Dropped %lu frames the reader didn't keep up with\n", static_cast<unsigned long>(gstocv.frames().dropped()));
+        }
+        if (gstocv.copiedFrames() > 0) {
+            g_print("Copied %lu frames, too many samples held or read-only buffers\n", static_cast<unsigned long>(gstocv.copiedFrames()));
+        }
 
         // Reset the initialization status
         initialized = false;
     }
-};
\ No newline at end of file
+};
@@ -1,25 +1,83 @@
 #include "GStreamerOpenCV.hpp"
 
-std::mutex GStreamerOpenCV::frameMutex_;
-std::condition_variable  GStreamerOpenCV::frameAvailable_; 
-cv::Mat GStreamerOpenCV::frame_;
-bool GStreamerOpenCV::end_of_stream_ = false;
-bool GStreamerOpenCV::isFrameReady_ = false;
+namespace
+{
+    // Mapping and sample reference behind a frame made by wrap_sample
+    struct MappedSample
+    {
+        GstSample* sample;
+        GstBuffer* buffer;
+        GstMapInfo map;
+        std::shared_ptr<std::atomic<int>> held;
+    };
+
+    // Current allocator of the wrapped frames: unmaps and unrefs the sample when the last Mat goes away.
+    // It never allocates, a Mat recreated with another size or type gets its own buffer.
+    class SampleMatAllocator : public cv::MatAllocator
+    {
+    public:
+        cv::UMatData* allocate(int, const int*, int, void*, size_t*, cv::AccessFlag, cv::UMatUsageFlags) const override
+        {
+            return nullptr;
+        }
+
+        bool allocate(cv::UMatData*, cv::AccessFlag, cv::UMatUsageFlags) const override
+        {
+            return false;
+        }
+
+        void deallocate(cv::UMatData* u) const override
+        {
+            MappedSample* mapped = static_cast<MappedSample*>(u->userdata);
+            gst_buffer_unmap(mapped->buffer, &mapped->map);
+            gst_sample_unref(mapped->sample);
+            mapped->held->fetch_sub(1, std::memory_order_relaxed);
+            delete mapped;
+            delete u;
+        }
+    };
 
+    const SampleMatAllocator sample_allocator;
 
-GStreamerOpenCV::GStreamerOpenCV() {
-    error_ = nullptr;
+    cv::Mat wrap_sample(GstSample* sample, GstBuffer* buffer, const GstMapInfo& map, const GstVideoInfo& info,
+        const std::shared_ptr<std::atomic<int>>& held)
+    {
+        cv::Mat frame(GST_VIDEO_INFO_HEIGHT(&info), GST_VIDEO_INFO_WIDTH(&info), CV_8UC3,
+            map.data + GST_VIDEO_INFO_PLANE_OFFSET(&info, 0), GST_VIDEO_INFO_PLANE_STRIDE(&info, 0));
+        cv::UMatData* u = new cv::UMatData(&sample_allocator);
+        u->data = u->origdata = map.data;
+        u->size = map.size;
+        u->refcount = 1;
+        u->userdata = new MappedSample{gst_sample_ref(sample), buffer, map, held};
+        held->fetch_add(1, std::memory_order_relaxed);
+        frame.u = u;
+        return frame;
+    }
 }
 
-void GStreamerOpenCV::setEndOfStream(bool value) {
-    end_of_stream_ = value;
+
+GStreamerOpenCV::GStreamerOpenCV(size_t frame_slots, size_t max_held_samples) :
+    frames_{frame_slots},
+    max_held_samples_{static_cast<int>(max_held_samples)},
+    held_samples_{std::make_shared<std::atomic<int>>(0)}
+{
 }
 
-bool GStreamerOpenCV::isEndOfStream() {
-    return end_of_stream_;
+bool GStreamerOpenCV::holdsSample(const cv::Mat& frame) {
+    return frame.u && frame.u->currAllocator == &sample_allocator;
 }
 
 GStreamerOpenCV::~GStreamerOpenCV() {
+    // The callbacks point to this instance, stop the streaming thread before going away
+    if (pipeline_) {
+        gst_element_set_state(pipeline_, GST_STATE_NULL);
+    }
+    if (bus_watch_) {
+        g_source_remove(bus_watch_);
+    }
+    if (sink_) {
+        gst_object_unref(sink_);
+    }
     if (pipeline_) {
         gst_object_unref(GST_OBJECT(pipeline_));
         pipeline_ = nullptr;
@@ -46,19 +104,15 @@ void GStreamerOpenCV::checkError() {
     }
 }
 
-cv::Mat GStreamerOpenCV::getFrame() const {
-    return frame_;
-}
-
-void GStreamerOpenCV::setFrame(const cv::Mat& frame) {
-    frame.copyTo(frame_);
-}
-
 std::string GStreamerOpenCV::getPipelineCommand(const std::string& link) const {
     if (link.find("rtsp") != std::string::npos)
-        return "rtspsrc location=" + link + " ! decodebin ! appsink name=autovideosink";
+        return "rtspsrc location=" + link + " ! decodebin ! videoconvert ! video/x-raw,format=BGR ! appsink name=autovideosink";
     else
-        return "filesrc location=" + link + " ! decodebin ! appsink name=autovideosink";
+        return "filesrc location=" + link + " ! decodebin ! videoconvert ! video/x-raw,format=BGR ! appsink name=autovideosink";
+}
+
+void GStreamerOpenCV::endOfStream(GstAppSink* appsink, gpointer data) {
+    static_cast<GStreamerOpenCV*>(data)->frames_.close();
 }
 
 GstFlowReturn GStreamerOpenCV::newPreroll(GstAppSink* appsink, gpointer data) {
@@ -67,47 +121,54 @@ GstFlowReturn GStreamerOpenCV::newPreroll(GstAppSink* appsink, gpointer data) {
 }
 
 GstFlowReturn GStreamerOpenCV::newSample(GstAppSink* appsink, gpointer data) {
-    isFrameReady_ = false;
-    static int frameWidth = 0, frameHeight = 0;
-    static int framecount = 0;
-    framecount++;
+    Trace::set_thread_name("gstreamer");
+    ScopedTrace trace("gst_new_sample");
+    GStreamerOpenCV* self = static_cast<GStreamerOpenCV*>(data);
+    self->samples_++;
 
     GstSample* sample = gst_app_sink_pull_sample(appsink);
     GstCaps* caps = gst_sample_get_caps(sample);
     GstBuffer* buffer = gst_sample_get_buffer(sample);
-    const GstStructure* info = gst_sample_get_info(sample);
-    const GstStructure* s = gst_caps_get_structure(caps, 0);
 
-    gboolean res = gst_structure_get_int(s, "width", &frameWidth);
-    res |= gst_structure_get_int(s, "height", &frameHeight);
-    if (!res) {
-        g_print("Could not get image width and height from filter caps\n");
+    GstVideoInfo info;
+    if (!gst_video_info_from_caps(&info, caps) || GST_VIDEO_INFO_FORMAT(&info) != GST_VIDEO_FORMAT_BGR) {
+        g_print("Expecting BGR video caps from videoconvert\n");
+        gst_sample_unref(sample);
         return GST_FLOW_OK;
     }
 
-    // Read frame and convert to OpenCV format
+    // Frames are drawn on downstream, so only buffers we own are wrapped, mapped writable
     GstMapInfo map;
-    gst_buffer_map(buffer, &map, GST_MAP_READ);
-
-    // Convert GStreamer data to OpenCV Mat
-    cv::Mat mYUV(frameHeight + frameHeight / 2, frameWidth, CV_8UC1, map.data);
-    cv::Mat mRGB(frameHeight, frameWidth, CV_8UC3);
-    cvtColor(mYUV, mRGB, cv::COLOR_YUV2RGBA_YV12, 3);
-  
-    // Signal that a new frame is available
-    {
-        std::lock_guard<std::mutex> lock(frameMutex_);
-        mRGB.copyTo(GStreamerOpenCV::frame_);
-        isFrameReady_ = true;
-        frameAvailable_.notify_one();
+    const bool wrap = self->held_samples_->load(std::memory_order_relaxed) < self->max_held_samples_ &&
+        gst_buffer_is_writable(buffer) && gst_buffer_map(buffer, &map, GST_MAP_READWRITE);
+    if (!wrap && !gst_buffer_map(buffer, &map, GST_MAP_READ)) {
+        g_print("Could not map the sample buffer\n");
+        gst_sample_unref(sample);
+        return GST_FLOW_OK;
     }
 
-    int frameSize = map.size;
-    gst_buffer_unmap(buffer, &map);
+    // Only a mapped frame takes a slot, begin_write drops the oldest frame when the ring is full
+    CapturedFrame& slot = self->frames_.begin_write();
+    if (wrap) {
+        slot.image = wrap_sample(sample, buffer, map, info, self->held_samples_);
+    }
+    else {
+        // The slot's own buffer is reused, unless it still holds a sample
+        if (holdsSample(slot.image)) {
+            slot.image.release();
+        }
+        cv::Mat(GST_VIDEO_INFO_HEIGHT(&info), GST_VIDEO_INFO_WIDTH(&info), CV_8UC3,
+            map.data + GST_VIDEO_INFO_PLANE_OFFSET(&info, 0), GST_VIDEO_INFO_PLANE_STRIDE(&info, 0)).copyTo(slot.image);
+        gst_buffer_unmap(buffer, &map);
+        self->copied_.fetch_add(1, std::memory_order_relaxed);
+    }
+    self->frames_.commit_write(GST_BUFFER_PTS_IS_VALID(buffer) ? static_cast<int64_t>(GST_BUFFER_PTS(buffer)) : -1);
 
     // Show caps on the first frame
-    if (framecount == 1) {
-        g_print("%s\n", gst_caps_to_string(caps));
+    if (self->samples_ == 1) {
+        gchar* caps_string = gst_caps_to_string(caps);
+        g_print("%s\n", caps_string);
+        g_free(caps_string);
     }
 
     gst_sample_unref(sample);
@@ -119,6 +180,7 @@ GstFlowReturn GStreamerOpenCV::newSample(GstAppSink* appsink, gpointer data) {
 }
 
 gboolean GStreamerOpenCV::myBusCallback(GstBus* bus, GstMessage* message, gpointer data) {
+    GStreamerOpenCV* self = static_cast<GStreamerOpenCV*>(data);
     switch (GST_MESSAGE_TYPE(message)) {
         case GST_MESSAGE_ERROR: {
             GError* err;
@@ -127,11 +189,13 @@ gboolean GStreamerOpenCV::myBusCallback(GstBus* bus, GstMessage* message, gpoint
             g_print("Error: %s\n", err->message);
             g_error_free(err);
             g_free(debug);
+            // No more samples will come, let the reader finish
+            self->frames_.close();
             break;
         }
         case GST_MESSAGE_EOS:{
 			g_message ("End of stream");
-            setEndOfStream(true); 
+            self->frames_.close();
             break;
         }
 
@@ -149,13 +213,15 @@ void GStreamerOpenCV::getSink() {
     gst_app_sink_set_emit_signals(GST_APP_SINK(sink_), true);
     gst_app_sink_set_drop(GST_APP_SINK(sink_), true);
     gst_app_sink_set_max_buffers(GST_APP_SINK(sink_), 1);
-    GstAppSinkCallbacks callbacks = { nullptr, newPreroll, newSample };
-    gst_app_sink_set_callbacks(GST_APP_SINK(sink_), &callbacks, nullptr, nullptr);
+    // The last sample reference would keep every buffer read-only, forcing the copy path
+    gst_base_sink_set_last_sample_enabled(GST_BASE_SINK(sink_), FALSE);
+    GstAppSinkCallbacks callbacks = { endOfStream, newPreroll, newSample };
+    gst_app_sink_set_callbacks(GST_APP_SINK(sink_), &callbacks, this, nullptr);
 }
 
 void GStreamerOpenCV::setBus() {
     bus_ = gst_pipeline_get_bus(GST_PIPELINE(pipeline_));
-    gst_bus_add_watch(bus_, myBusCallback, nullptr);
+    bus_watch_ = gst_bus_add_watch(bus_, myBusCallback, this);
     gst_object_unref(bus_);
 }
 
@@ -1,18 +1,29 @@
 #pragma once
 #include "common.hpp"
+#include "Trace.hpp"
+#include "FrameRing.hpp"
 #include <gst/gst.h>
 #include <gst/app/gstappsink.h>
+#include <gst/base/gstbasesink.h>
+#include <gst/video/video.h>
+#include <atomic>
 #include <string>
 #include <memory>
-#include <condition_variable>
-#include <mutex>
 
+// One GStreamer pipeline decoding into an appsink. Every instance has its own state, the sink and bus
+// callbacks receive the instance as user data, so a process can run any number of pipelines.
+// videoconvert outputs BGR and frames are cv::Mat headers over the mapped GstBuffer, each holding its
+// sample until the last Mat referencing it is released. At most max_held_samples are held at once,
+// beyond that (or for buffers we can't map writable) frames are copied, so upstream pools never starve.
 class GStreamerOpenCV {
 
 
 public:
-    GStreamerOpenCV();
+    explicit GStreamerOpenCV(size_t frame_slots = 4, size_t max_held_samples = 8);
     ~GStreamerOpenCV();
+    GStreamerOpenCV(const GStreamerOpenCV&) = delete;
+    GStreamerOpenCV& operator=(const GStreamerOpenCV&) = delete;
+
     void initGstLibrary(int argc, char* argv[]);
     void runPipeline(const std::string& link);
     void checkError();
@@ -20,18 +31,16 @@ public:
     void setBus();
     void setState(GstState state);
     void setMainLoopEvent(bool event);
-    cv::Mat getFrame() const;
-    void setFrame(const cv::Mat& frame);
-
-    static void setEndOfStream(bool value);
-    static bool isEndOfStream();
-
 
-    static std::mutex frameMutex_; // Mutex to protect frame access
-    static std::condition_variable frameAvailable_; // Condition variable to signal new frames
-    static bool isFrameReady_;
+    // Decoded frames, written by the streaming thread
+    FrameRing& frames() { return frames_; }
+    bool isEndOfStream() const { return frames_.finished(); }
+    uint64_t copiedFrames() const { return copied_.load(std::memory_order_relaxed); }
+    // frame points into a sample of some GStreamerOpenCV
+    static bool holdsSample(const cv::Mat& frame);
 
 private:
+    static void endOfStream(GstAppSink* appsink, gpointer data);
     static GstFlowReturn newPreroll(GstAppSink* appsink, gpointer data);
     static GstFlowReturn newSample(GstAppSink* appsink, gpointer data);
     static gboolean myBusCallback(GstBus* bus, GstMessage* message, gpointer data);
@@ -40,11 +49,15 @@ private:
     GstElement* pipeline_ = nullptr;
     GstElement* sink_ = nullptr;
     GstBus* bus_ = nullptr;
-    static cv::Mat frame_;
-    static bool end_of_stream_;
+    guint bus_watch_ = 0;
+    uint64_t samples_ = 0;
+    FrameRing frames_;
+    const int max_held_samples_;
+    std::shared_ptr<std::atomic<int>> held_samples_;    // Outlives this instance while frames are out
+    std::atomic<uint64_t> copied_{0};
 
 
 
     std::string getPipelineCommand(const std::string& link) const;
 
-};
\ No newline at end of file
+};
@@ -0,0 +1,27 @@
+#include <gtest/gtest.h>
+#include "DetectionSink.hpp"
+#include <fstream>
+
+TEST(DetectionSinkTest, JsonLinesEscapesStrings)
+{
+    const std::string path = (std::filesystem::temp_directory_path() / "detection_sink_test.jsonl").string();
+    {
+        JsonLinesSink sink(path, { "a \"quoted\"\\label\n", std::string("bell\x07") });
+        Detection d;
+        d.label = 0;
+        d.score = 0.5f;
+        d.bbox = cv::Rect(1, 2, 3, 4);
+        Detection e = d;
+        e.label = 1;
+        sink.set_blocking(true);
+        EXPECT_TRUE(sink.write(0, 0, 7, { d, e }, "dir\\file\t1.jpg"));
+    }
+    std::ifstream file(path);
+    std::string line;
+    ASSERT_TRUE(std::getline(file, line));
+    EXPECT_NE(line.find("\"source\":\"dir\\\\file\\t1.jpg\""), std::string::npos) << line;
+    EXPECT_NE(line.find("\"label\":\"a \\\"quoted\\\"\\\\label\\n\""), std::string::npos) << line;
+    EXPECT_NE(line.find("\"label\":\"bell\\u0007\""), std::string::npos) << line;
+    EXPECT_FALSE(std::getline(file, line));
+    std::filesystem::remove(path);
+}
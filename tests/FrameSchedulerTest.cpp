@@ -0,0 +1,56 @@
+#include <gtest/gtest.h>
+#include "FrameScheduler.hpp"
+
+using namespace std::chrono_literals;
+
+namespace
+{
+    // Decides a frame captured now, and completes its inference right away when it is inferred
+    FrameDecision run_frame(FrameScheduler& scheduler, std::chrono::nanoseconds inference)
+    {
+        const FrameDecision decision = scheduler.decide(FrameScheduler::Clock::now());
+        if (decision == FrameDecision::Infer)
+        {
+            scheduler.record_inference(inference);
+        }
+        return decision;
+    }
+}
+
+TEST(FrameSchedulerTest, DisabledInfersEveryFrame)
+{
+    FrameScheduler scheduler;
+    for (int i = 0; i < 4; ++i)
+    {
+        EXPECT_EQ(scheduler.decide(FrameScheduler::Clock::now()), FrameDecision::Infer);
+    }
+}
+
+TEST(FrameSchedulerTest, IdleEngineAlwaysInfers)
+{
+    FrameScheduler scheduler(50ms);
+    // Far over the budget, but nothing is waiting for the engine
+    for (int i = 0; i < 4; ++i)
+    {
+        EXPECT_EQ(run_frame(scheduler, 200ms), FrameDecision::Infer);
+    }
+}
+
+TEST(FrameSchedulerTest, RecoversOnceInferenceFitsTheBudgetAgain)
+{
+    FrameScheduler scheduler(50ms);
+    EXPECT_EQ(run_frame(scheduler, 200ms), FrameDecision::Infer);
+
+    // Slow spell: with a frame already waiting for the engine the next one can't fit
+    EXPECT_EQ(scheduler.decide(FrameScheduler::Clock::now()), FrameDecision::Infer);
+    EXPECT_EQ(scheduler.decide(FrameScheduler::Clock::now()), FrameDecision::Reuse);
+    scheduler.record_inference(200ms);
+
+    // Idle frames keep measuring, the estimate follows the engine back under the budget
+    for (int i = 0; i < 64; ++i)
+    {
+        EXPECT_EQ(run_frame(scheduler, 1ms), FrameDecision::Infer);
+    }
+    EXPECT_EQ(scheduler.decide(FrameScheduler::Clock::now()), FrameDecision::Infer);
+    EXPECT_EQ(scheduler.decide(FrameScheduler::Clock::now()), FrameDecision::Infer);
+}
@@ -0,0 +1,83 @@
+#include <gtest/gtest.h>
+#include "InferenceInterface.hpp"
+
+namespace
+{
+    // Fails every other call, runs on the default asynchronous worker
+    class FlakyEngine : public InferenceInterface
+    {
+    public:
+        FlakyEngine() : InferenceInterface{"", ""} {}
+        ~FlakyEngine() override { shutdown_async(); }
+
+        std::vector<TensorView> get_infer_results(const cv::Mat& input_blob) override
+        {
+            if (calls_++ % 2 == 1)
+            {
+                throw std::runtime_error("inference failed");
+            }
+            return {};
+        }
+
+    private:
+        int calls_{0};
+    };
+}
+
+TEST(InferenceInterfaceTest, AsyncFailureRethrowsFromTheFuture)
+{
+    FlakyEngine engine;
+    const cv::Mat blob(1, 4, CV_32F, cv::Scalar(0));
+    EXPECT_NO_THROW(engine.infer_async(blob).get());
+    EXPECT_THROW(engine.infer_async(blob).get(), std::runtime_error);
+    EXPECT_NO_THROW(engine.infer_async(blob).get());
+}
+
+TEST(InferenceInterfaceTest, DestructorWaitsForPendingRequests)
+{
+    auto engine = std::make_unique<FlakyEngine>();
+    engine->set_max_outstanding(4);
+    const cv::Mat blob(1, 4, CV_32F, cv::Scalar(0));
+    std::vector<std::future<std::vector<TensorView>>> results;
+    for (int i = 0; i < 4; ++i)
+    {
+        results.push_back(engine->infer_async(blob));
+    }
+    engine.reset();
+    for (auto& result : results)
+    {
+        EXPECT_EQ(result.wait_for(std::chrono::seconds(0)), std::future_status::ready);
+    }
+}
+
+namespace
+{
+    // Rejects every submission, like a native asynchronous API failing before it queues anything
+    class RejectingEngine : public InferenceInterface
+    {
+    public:
+        RejectingEngine() : InferenceInterface{"", ""} {}
+        ~RejectingEngine() override { shutdown_async(); }
+
+        std::vector<TensorView> get_infer_results(const cv::Mat& input_blob) override
+        {
+            return {};
+        }
+
+    protected:
+        void submit_async(const cv::Mat& input_blob, AsyncCallback on_complete) override
+        {
+            throw std::runtime_error("submission failed");
+        }
+    };
+}
+
+TEST(InferenceInterfaceTest, FailedSubmissionReleasesItsSlot)
+{
+    RejectingEngine engine;
+    const cv::Mat blob(1, 4, CV_32F, cv::Scalar(0));
+    // max_outstanding is 1, a leaked slot would block the second call
+    EXPECT_THROW(engine.infer_async(blob).get(), std::runtime_error);
+    EXPECT_THROW(engine.infer_async(blob).get(), std::runtime_error);
+    engine.wait_async();
+}
@@ -0,0 +1,16 @@
+#include <gtest/gtest.h>
+#include "JsonString.hpp"
+
+TEST(JsonStringTest, EscapesQuotesBackslashesAndControlCharacters)
+{
+    EXPECT_EQ(json_string("C:\\data\\\"cam 1\".mp4"), "C:\\\\data\\\\\\\"cam 1\\\".mp4");
+    EXPECT_EQ(json_string("a\tb\nc\r\x01"), "a\\tb\\nc\\r\\u0001");
+    EXPECT_EQ(json_string("caf\xc3\xa9"), "caf\xc3\xa9");
+}
+
+TEST(JsonStringTest, AppendKeepsTheExistingContent)
+{
+    std::string out = "{\"source\":\"";
+    append_json_string(out, "a\"b");
+    EXPECT_EQ(out, "{\"source\":\"a\\\"b");
+}
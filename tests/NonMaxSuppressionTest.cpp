@@ -0,0 +1,54 @@
+#include <gtest/gtest.h>
+#include "NonMaxSuppression.hpp"
+#include <random>
+
+namespace
+{
+    // Mostly small boxes plus a few covering a large part of the image
+    BoxCandidates random_candidates(size_t count, unsigned seed)
+    {
+        std::mt19937 rng(seed);
+        std::uniform_real_distribution<float> position(0.f, 1000.f);
+        std::uniform_real_distribution<float> small_side(5.f, 40.f);
+        std::uniform_real_distribution<float> large_side(300.f, 1000.f);
+        std::uniform_real_distribution<float> score(0.f, 1.f);
+        std::uniform_int_distribution<int> class_id(0, 3);
+        BoxCandidates candidates;
+        for (size_t i = 0; i < count; ++i)
+        {
+            const float x = position(rng), y = position(rng);
+            const bool large = i % 50 == 0;
+            const float w = large ? large_side(rng) : small_side(rng);
+            const float h = large ? large_side(rng) : small_side(rng);
+            candidates.add(x, y, x + w, y + h, score(rng), class_id(rng));
+        }
+        return candidates;
+    }
+}
+
+TEST(NonMaxSuppressionTest, GridMatchesAllPairs)
+{
+    for (const bool class_aware : { false, true })
+    {
+        const BoxCandidates candidates = random_candidates(3000, class_aware ? 2 : 1);
+        NonMaxSuppression all_pairs(0, std::numeric_limits<size_t>::max());
+        NonMaxSuppression grid(0, 1);
+        const std::vector<int> expected = all_pairs.run(candidates, 0.3f, class_aware);
+        EXPECT_EQ(grid.run(candidates, 0.3f, class_aware), expected);
+    }
+}
+
+TEST(NonMaxSuppressionTest, TopKKeepsTheBestCandidates)
+{
+    const BoxCandidates candidates = random_candidates(3000, 3);
+    NonMaxSuppression nms;
+    nms.set_top_k(10);
+    const std::vector<int> kept = nms.run(candidates, 1.f, false);
+    ASSERT_EQ(kept.size(), 10u);
+    std::vector<float> scores = candidates.scores;
+    std::nth_element(scores.begin(), scores.begin() + 9, scores.end(), std::greater<float>());
+    for (const int i : kept)
+    {
+        EXPECT_GE(candidates.scores[i], scores[9]);
+    }
+}
@@ -0,0 +1,94 @@
+#include <gtest/gtest.h>
+#include "SlotBatcher.hpp"
+#include <thread>
+
+namespace
+{
+    // Answers every image of a batch with a copy of its own input value and records the batch sizes
+    class EchoEngine : public InferenceInterface
+    {
+    public:
+        EchoEngine() : InferenceInterface{"", ""} {}
+
+        size_t max_batch_size() const override
+        {
+            return 8;
+        }
+
+        std::vector<TensorView> get_infer_results(const cv::Mat& input_blob) override
+        {
+            const int rows = input_blob.size[0];
+            batch_sizes.push_back(rows);
+            auto values = std::make_shared<std::vector<float>>(input_blob.ptr<float>(), input_blob.ptr<float>() + rows);
+            return {TensorView(TensorType::Float32, {rows, 1}, values->data(), values)};
+        }
+
+        std::vector<size_t> batch_sizes;
+    };
+}
+
+TEST(SlotBatcherTest, EveryFilledSlotComesBackWithItsOwnOutputs)
+{
+    constexpr size_t producers = 3;
+    constexpr int frames = 40;
+    constexpr size_t max_batch = 4;
+    EchoEngine engine;
+    SlotBatcher batcher(engine, producers, max_batch, std::chrono::milliseconds(1), 2);
+
+    std::vector<int> finished(producers, 0);
+    std::vector<bool> in_order(producers, true);
+    std::vector<std::thread> threads;
+    for (size_t p = 0; p < producers; ++p)
+    {
+        threads.emplace_back([&, p]
+        {
+            int next = 0;
+            int expected = 0;
+            batcher.run_producer(p,
+                [&](FrameSlot& slot)
+                {
+                    if (next == frames)
+                    {
+                        return SlotBatcher::Fill::Ended;
+                    }
+                    // Every fifth frame is unusable and never reaches the batcher
+                    if (++next % 5 == 0)
+                    {
+                        return SlotBatcher::Fill::Skipped;
+                    }
+                    slot.index = next;
+                    slot.blob = cv::Mat(1, 1, CV_32F, cv::Scalar(static_cast<float>(p * 1000 + next)));
+                    return SlotBatcher::Fill::Ready;
+                },
+                [&](FrameSlot& slot)
+                {
+                    ASSERT_EQ(slot.outputs.size(), 1u);
+                    EXPECT_EQ(*slot.outputs[0].data<float>(), static_cast<float>(p * 1000 + slot.index));
+                    if (++expected % 5 == 0)
+                    {
+                        ++expected;
+                    }
+                    in_order[p] = in_order[p] && static_cast<int>(slot.index) == expected;
+                    ++finished[p];
+                });
+        });
+    }
+    batcher.run_batcher([] {});
+    for (auto& thread : threads)
+    {
+        thread.join();
+    }
+
+    size_t batched = 0;
+    for (size_t size : engine.batch_sizes)
+    {
+        EXPECT_LE(size, max_batch);
+        batched += size;
+    }
+    EXPECT_EQ(batched, producers * (frames - frames / 5));
+    for (size_t p = 0; p < producers; ++p)
+    {
+        EXPECT_EQ(finished[p], frames - frames / 5);
+        EXPECT_TRUE(in_order[p]);
+    }
+}